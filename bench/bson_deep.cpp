@@ -0,0 +1,64 @@
+//parse_bson on change-stream style events: a shallow envelope around a deeply nested fullDocument
+//usage: bson_deep [depth] [documents] [rounds]
+#include "json_view.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace nicehero;
+
+static std::string deepDoc(int depth, int width, int seed)
+{
+	if (depth == 0) {
+		return "{\"v\":" + std::to_string(seed) + ",\"s\":\"leaf-" + std::to_string(seed) + "\",\"d\":1.5,\"b\":true,\"z\":null}";
+	}
+	std::string s = "{\"level\":" + std::to_string(depth) + ",\"name\":\"node\",\"items\":[";
+	for (int i = 0; i < width; ++i) {
+		if (i) {
+			s += ",";
+		}
+		s += std::to_string(seed * 31 + i);
+	}
+	s += "],\"children\":[";
+	for (int i = 0; i < 2; ++i) {
+		if (i) {
+			s += ",";
+		}
+		s += deepDoc(depth - 1, width, seed * 2 + i);
+	}
+	return s + "]}";
+}
+
+int main(int argc, char** argv)
+{
+	int depth = argc > 1 ? atoi(argv[1]) : 7;
+	int count = argc > 2 ? atoi(argv[2]) : 200;
+	int rounds = argc > 3 ? atoi(argv[3]) : 60;
+	std::vector<std::vector<uint8_t>> docs;
+	size_t bytes = 0;
+	for (int i = 0; i < count; ++i) {
+		std::string src = "{\"_id\":{\"_data\":\"8263" + std::to_string(i) + "\"},\"operationType\":\"update\",\"fullDocument\":"
+			+ deepDoc(depth, 6, i) + "}";
+		json_view j;
+		j.parse(src.c_str(), false);
+		docs.push_back(j.dump_bson());
+		bytes += docs.back().size();
+	}
+	size_t total = 0;
+	double best = 1e30;
+	for (int r = 0; r < rounds; ++r) {
+		auto a = std::chrono::steady_clock::now();
+		for (auto& d : docs) {
+			json_view j;
+			j.parse_bson(d);
+			total += j["fullDocument"]["children"].size();
+		}
+		auto b = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::milli>(b - a).count());
+	}
+	std::cout << "parse_bson depth " << depth << ", " << count << " documents, " << bytes << " bytes: best of "
+		<< rounds << " rounds " << best << " ms, " << (bytes / 1e6) / (best / 1e3) << " MB/s (" << total << ")" << std::endl;
+	return 0;
+}
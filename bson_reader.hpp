@@ -0,0 +1,369 @@
+#ifndef __NICEHERO_BSON_READER__
+#define __NICEHERO_BSON_READER__
+#include "bson_view.hpp"
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+namespace nicehero
+{
+	//read-only memory map of a whole file, unmapped when destroyed
+	class mapped_file {
+	public:
+		mapped_file() {}
+		explicit mapped_file(const char* path) {
+			open(path);
+		}
+		~mapped_file() {
+			close();
+		}
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		//false if the file cannot be opened or mapped, an empty file opens with size() 0
+		bool open(const char* path) {
+			close();
+#if defined(_WIN32)
+			HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE) {
+				return false;
+			}
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(file, &size)) {
+				CloseHandle(file);
+				return false;
+			}
+			if (size.QuadPart > 0) {
+				HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping) {
+					m_data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+					CloseHandle(mapping);
+				}
+				if (!m_data) {
+					CloseHandle(file);
+					return false;
+				}
+			}
+			CloseHandle(file);
+			m_size = size_t(size.QuadPart);
+#else
+			int fd = ::open(path, O_RDONLY);
+			if (fd < 0) {
+				return false;
+			}
+			struct stat st;
+			if (fstat(fd, &st) != 0) {
+				::close(fd);
+				return false;
+			}
+			if (st.st_size > 0) {
+				void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+				if (p == MAP_FAILED) {
+					::close(fd);
+					return false;
+				}
+#if defined(MADV_SEQUENTIAL)
+				//documents are read front to back, read ahead aggressively
+				madvise(p, size_t(st.st_size), MADV_SEQUENTIAL);
+#endif
+				m_data = (const uint8_t*)p;
+			}
+			::close(fd);
+			m_size = size_t(st.st_size);
+#endif
+			m_open = true;
+			return true;
+		}
+		void close() {
+			if (m_data) {
+#if defined(_WIN32)
+				UnmapViewOfFile(m_data);
+#else
+				munmap((void*)m_data, m_size);
+#endif
+			}
+			m_data = nullptr;
+			m_size = 0;
+			m_open = false;
+		}
+		bool is_open() const {
+			return m_open;
+		}
+		const uint8_t* data() const {
+			return m_data;
+		}
+		size_t size() const {
+			return m_size;
+		}
+	private:
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+		bool m_open = false;
+	};
+
+	//concatenated BSON documents such as mongodump .bson files, split at their int32 length
+	//prefixes in one scan, documents are then read in place or handed to threads in batches
+	//the documents are not validated, run validate_bson on them first if the file is untrusted
+	class bson_reader {
+	public:
+		static constexpr size_t parallel_min_documents = 64;
+		static constexpr size_t default_batch_size = 256;
+
+		bson_reader() {}
+		bson_reader(const uint8_t* data, size_t len) {
+			scan(data, len);
+		}
+		explicit bson_reader(const char* path) {
+			open(path);
+		}
+		bson_reader(const bson_reader&) = delete;
+		bson_reader& operator=(const bson_reader&) = delete;
+
+		//maps the file and scans it, see scan
+		bool open(const char* path) {
+			if (!m_file.open(path)) {
+				scan(nullptr, 0);
+				return false;
+			}
+			return scan(m_file.data(), m_file.size());
+		}
+		//finds the document boundaries in data, which has to outlive the reader
+		//false if the data does not end on a document boundary, the documents in front are kept
+		bool scan(const uint8_t* data, size_t len) {
+			m_data = data;
+			m_size = len;
+			m_offsets.clear();
+			size_t off = 0;
+			while (len - off >= 5) {
+				int32_t n = bson_view::load<int32_t>(data + off);
+				if (n < 5 || size_t(n) > len - off || data[off + size_t(n) - 1] != 0) {
+					break;
+				}
+				m_offsets.push_back(off);
+				off += size_t(n);
+			}
+			//the end of the last document closes the table
+			m_offsets.push_back(off);
+			return off == len;
+		}
+		size_t size() const {
+			return m_offsets.empty() ? 0 : m_offsets.size() - 1;
+		}
+		bool empty() const {
+			return size() == 0;
+		}
+		//false if scan stopped in front of a broken or truncated document at scanned_size()
+		bool complete() const {
+			return scanned_size() == m_size;
+		}
+		size_t scanned_size() const {
+			return m_offsets.empty() ? 0 : m_offsets.back();
+		}
+		const uint8_t* data() const {
+			return m_data;
+		}
+		//offset of the i-th document in data()
+		size_t offset(size_t i) const {
+			return m_offsets[i];
+		}
+		//invalid view past the end
+		bson_view operator[](size_t i) const {
+			if (i >= size()) {
+				return bson_view();
+			}
+			return bson_view(m_data + m_offsets[i], m_offsets[i + 1] - m_offsets[i]);
+		}
+		bson_view at(size_t i) const {
+			return (*this)[i];
+		}
+
+		//calls f(i, bson_view) for every document on threads (0: one per core) pulling batches,
+		//in no particular order, f must be safe to call concurrently
+		//the first exception thrown by f stops the batches and is rethrown once the threads are joined
+		//writing results to out[i] keeps them in document order
+		template <class F>
+		void for_each_parallel(const F& f, size_t threads = 0, size_t batch = default_batch_size) const {
+			size_t s = size();
+			threads = _threads(threads, s);
+			if (batch == 0) {
+				batch = 1;
+			}
+			size_t batchCount = (s + batch - 1) / batch;
+			std::atomic<size_t> next(0);
+			std::atomic<bool> stop(false);
+			//the first exception of f, rethrown here once every thread has stopped
+			std::exception_ptr error;
+			std::mutex m;
+			auto work = [&]() {
+				while (!stop) {
+					size_t b = next++;
+					if (b >= batchCount) {
+						return;
+					}
+					try {
+						size_t end = std::min(s, (b + 1) * batch);
+						for (size_t i = b * batch; i < end; ++i) {
+							f(i, (*this)[i]);
+						}
+					}
+					catch (...) {
+						std::lock_guard<std::mutex> l(m);
+						if (!error) {
+							error = std::current_exception();
+						}
+						stop = true;
+					}
+				}
+			};
+			std::vector<std::thread> pool;
+			auto finish = [&]() {
+				stop = true;
+				for (auto& t : pool) {
+					t.join();
+				}
+			};
+			try {
+				for (size_t t = 1; t < threads; ++t) {
+					pool.emplace_back(work);
+				}
+			}
+			catch (...) {
+				finish();
+				throw;
+			}
+			work();
+			finish();
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+
+		//threads (0: one per core) parse batches of documents ahead while f(i, json_view&) runs
+		//on the calling thread in document order, at most two batches per thread wait for f
+		//the json_views read the documents in place and are reused after f returns
+		template <class F>
+		void for_each_parsed(const F& f, size_t threads = 0, size_t batch = default_batch_size) const {
+			size_t s = size();
+			threads = _threads(threads, s);
+			if (threads < 2) {
+				for (size_t i = 0; i < s; ++i) {
+					json_view j;
+					_parse(j, i);
+					f(i, j);
+				}
+				return;
+			}
+			if (batch == 0) {
+				batch = 1;
+			}
+			size_t batchCount = (s + batch - 1) / batch;
+			size_t window = std::min(batchCount, threads * 2);
+			std::vector<std::vector<json_view>> slots(window);
+			//batch number + 1 held by each slot once it is parsed
+			std::vector<size_t> ready(window, 0);
+			std::atomic<size_t> next(0);
+			bool stop = false;
+			size_t consumed = 0;
+			std::mutex m;
+			std::condition_variable cv;
+			auto work = [&]() {
+				while (true) {
+					size_t b = next++;
+					if (b >= batchCount) {
+						return;
+					}
+					{
+						std::unique_lock<std::mutex> l(m);
+						cv.wait(l, [&]() { return b < consumed + window || stop; });
+						if (stop) {
+							return;
+						}
+					}
+					std::vector<json_view>& docs = slots[b % window];
+					size_t begin = b * batch;
+					size_t end = std::min(s, begin + batch);
+					docs.resize(end - begin);
+					for (size_t i = begin; i < end; ++i) {
+						_parse(docs[i - begin], i);
+					}
+					{
+						std::lock_guard<std::mutex> l(m);
+						ready[b % window] = b + 1;
+					}
+					cv.notify_all();
+				}
+			};
+			std::vector<std::thread> pool;
+			pool.reserve(threads);
+			for (size_t t = 0; t < threads && t < batchCount; ++t) {
+				pool.emplace_back(work);
+			}
+			auto finish = [&]() {
+				{
+					std::lock_guard<std::mutex> l(m);
+					stop = true;
+				}
+				cv.notify_all();
+				for (auto& t : pool) {
+					t.join();
+				}
+			};
+			try {
+				for (size_t b = 0; b < batchCount; ++b) {
+					{
+						std::unique_lock<std::mutex> l(m);
+						cv.wait(l, [&]() { return ready[b % window] == b + 1; });
+					}
+					std::vector<json_view>& docs = slots[b % window];
+					for (size_t i = 0; i < docs.size(); ++i) {
+						f(b * batch + i, docs[i]);
+					}
+					{
+						std::lock_guard<std::mutex> l(m);
+						consumed = b + 1;
+					}
+					cv.notify_all();
+				}
+			}
+			catch (...) {
+				finish();
+				throw;
+			}
+			finish();
+		}
+		//every document parsed on threads (0: one per core), out[i] is the i-th document
+		void parse_parallel(std::vector<json_view>& out, size_t threads = 0) const {
+			out.clear();
+			out.resize(size());
+			for_each_parallel([this, &out](size_t i, const bson_view&) {
+				_parse(out[i], i);
+			}, threads);
+		}
+	private:
+		size_t _threads(size_t threads, size_t s) const {
+			if (threads == 0) {
+				threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+			}
+			if (s < parallel_min_documents) {
+				return 1;
+			}
+			return threads;
+		}
+		void _parse(json_view& j, size_t i) const {
+			j.parse_bson(viewvalue((const char*)m_data + m_offsets[i], uint32_t(m_offsets[i + 1] - m_offsets[i])));
+		}
+		mapped_file m_file;
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+		std::vector<size_t> m_offsets;
+	};
+}
+
+#endif
@@ -0,0 +1,1225 @@
+#ifndef __NICEHERO_BSON_VIEW__
+#define __NICEHERO_BSON_VIEW__
+#include "json_view.hpp"
+#include <limits>
+
+namespace nicehero
+{
+	enum class bson_type : uint8_t
+	{
+		bson_eod = 0x00,
+		bson_double = 0x01,
+		bson_string = 0x02,
+		bson_document = 0x03,
+		bson_array = 0x04,
+		bson_binary = 0x05,
+		bson_undefined = 0x06,
+		bson_object_id = 0x07,
+		bson_boolean = 0x08,
+		bson_datetime = 0x09,
+		bson_null = 0x0A,
+		bson_regex = 0x0B,
+		bson_db_pointer = 0x0C,
+		bson_javascript = 0x0D,
+		bson_symbol = 0x0E,
+		bson_javascript_scope = 0x0F,
+		bson_int32 = 0x10,
+		bson_timestamp = 0x11,
+		bson_int64 = 0x12,
+		bson_decimal128 = 0x13,
+		bson_max_key = 0x7F,
+		bson_min_key = 0xFF,
+	};
+
+	//read-only view of a BSON document or array, nothing is copied or allocated
+	//lookups walk the elements and skip values by their encoded length,
+	//a length running past the document ends the walk
+	class bson_view {
+	public:
+		using jvalue_type = viewvalue;
+		static constexpr size_t npos = size_t(-1);
+
+		template <class NumberType>
+		static NumberType load(const uint8_t* p) {
+			NumberType result;
+			if (json_view::little_endianness()) {
+				std::memcpy(&result, p, sizeof(NumberType));
+				return result;
+			}
+			std::array<uint8_t, sizeof(NumberType)> vec{};
+			for (std::size_t i = 0; i < sizeof(NumberType); ++i) {
+				vec[sizeof(NumberType) - i - 1] = p[i];
+			}
+			std::memcpy(&result, vec.data(), sizeof(NumberType));
+			return result;
+		}
+
+		//bytes of a value of type t at p, npos for an unknown type or a value longer than avail
+		static size_t value_size(uint8_t t, const uint8_t* p, size_t avail) {
+			size_t n = 0;
+			switch (t) {
+			case 0x06: // undefined
+			case 0x0A: // null
+			case 0x7F: // max key
+			case 0xFF: // min key
+				return 0;
+			case 0x08: // boolean
+				n = 1;
+				break;
+			case 0x10: // int32
+				n = sizeof(int32_t);
+				break;
+			case 0x01: // double
+			case 0x09: // UTC datetime
+			case 0x11: // timestamp
+			case 0x12: // int64
+				n = sizeof(int64_t);
+				break;
+			case 0x07: // ObjectId
+				n = 12;
+				break;
+			case 0x13: // decimal128
+				n = 16;
+				break;
+			case 0x02: // string
+			case 0x0D: // JavaScript code
+			case 0x0E: // symbol
+			case 0x0C: // DBPointer, string and ObjectId
+			{
+				if (avail < sizeof(int32_t)) {
+					return npos;
+				}
+				int32_t len = load<int32_t>(p);
+				if (len < 1) {
+					return npos;
+				}
+				n = sizeof(int32_t) + size_t(len) + (t == 0x0C ? 12 : 0);
+				break;
+			}
+			case 0x03: // object
+			case 0x04: // array
+			case 0x0F: // JavaScript code with scope
+			{
+				if (avail < sizeof(int32_t)) {
+					return npos;
+				}
+				int32_t len = load<int32_t>(p);
+				if (len < 5) {
+					return npos;
+				}
+				n = size_t(len);
+				break;
+			}
+			case 0x05: // binary, int32 length and a subtype byte
+			{
+				if (avail < sizeof(int32_t)) {
+					return npos;
+				}
+				int32_t len = load<int32_t>(p);
+				if (len < 0) {
+					return npos;
+				}
+				n = sizeof(int32_t) + 1 + size_t(len);
+				break;
+			}
+			case 0x0B: // regular expression, pattern and options cstrings
+			{
+				auto e1 = (const uint8_t*)memchr(p, 0, avail);
+				if (!e1) {
+					return npos;
+				}
+				auto e2 = (const uint8_t*)memchr(e1 + 1, 0, avail - size_t(e1 + 1 - p));
+				if (!e2) {
+					return npos;
+				}
+				return size_t(e2 + 1 - p);
+			}
+			default:
+				return npos;
+			}
+			return n <= avail ? n : npos;
+		}
+
+		//checks the document at data the way parse_bson and bson_view read it:
+		//sizes inside their parents, NUL-terminated keys and strings, known type codes,
+		//booleans of 0 or 1 and nesting of at most maxDepth documents
+		//a document that passes can be parsed without bounds checks
+		static bool validate(const uint8_t* data, size_t len, int maxDepth = 100) {
+			if (!data || len < 5) {
+				return false;
+			}
+			int32_t documentSize = load<int32_t>(data);
+			if (documentSize < 5 || size_t(documentSize) > len) {
+				return false;
+			}
+			return _validateDocument(data, size_t(documentSize), maxDepth);
+		}
+		bool validate(int maxDepth = 100) const {
+			return m_data && _validateDocument(m_data, m_size, maxDepth);
+		}
+
+		class element {
+		public:
+			element() {}
+			bson_type type() const {
+				return bson_type(m_type);
+			}
+			//false for the element of a failed lookup
+			bool valid() const {
+				return m_value != nullptr;
+			}
+			explicit operator bool() const {
+				return valid();
+			}
+			jvalue_type key() const {
+				return jvalue_type(m_key, m_keyLen);
+			}
+			//encoded value bytes, without type and key
+			const uint8_t* value_data() const {
+				return m_value;
+			}
+			size_t value_size() const {
+				return m_valueSize;
+			}
+
+			inline bool is_null() const {
+				return m_type == 0x0A;
+			}
+			inline bool is_document() const {
+				return m_type == 0x03;
+			}
+			inline bool is_array() const {
+				return m_type == 0x04;
+			}
+			inline bool is_string() const {
+				return m_type == 0x02;
+			}
+			inline bool is_number() const {
+				return m_type == 0x01 || m_type == 0x10 || m_type == 0x12;
+			}
+
+			inline double as_double() const {
+				switch (m_type) {
+				case 0x01:
+					return load<double>(m_value);
+				case 0x10:
+					return double(load<int32_t>(m_value));
+				case 0x12:
+				case 0x09:
+					return double(load<int64_t>(m_value));
+				default:
+					return 0.0;
+				}
+			}
+			inline int64_t as_int64() const {
+				switch (m_type) {
+				case 0x10:
+					return load<int32_t>(m_value);
+				case 0x12:
+				case 0x09:
+					return load<int64_t>(m_value);
+				case 0x01:
+					return int64_t(load<double>(m_value));
+				case 0x08:
+					return m_value[0] ? 1 : 0;
+				default:
+					return 0;
+				}
+			}
+			inline int32_t as_int32() const {
+				return int32_t(as_int64());
+			}
+			inline bool as_boolean() const {
+				if (m_type == 0x08) {
+					return m_value[0] != 0;
+				}
+				return as_int64() != 0;
+			}
+			//string, JavaScript code or symbol, without the terminating NUL
+			inline jvalue_type as_string() const {
+				if (m_type == 0x02 || m_type == 0x0D || m_type == 0x0E) {
+					return jvalue_type((const char*)m_value + sizeof(int32_t), uint32_t(load<int32_t>(m_value) - 1));
+				}
+				return jvalue_type("");
+			}
+			//milliseconds since the epoch
+			inline int64_t as_datetime() const {
+				return m_type == 0x09 ? load<int64_t>(m_value) : 0;
+			}
+			inline uint64_t as_timestamp() const {
+				return m_type == 0x11 ? load<uint64_t>(m_value) : 0;
+			}
+			//the 12 ObjectId bytes, nullptr for the other types
+			inline const uint8_t* as_object_id() const {
+				return m_type == 0x07 ? m_value : nullptr;
+			}
+			//the 16 decimal128 bytes, nullptr for the other types
+			inline const uint8_t* as_decimal128() const {
+				return m_type == 0x13 ? m_value : nullptr;
+			}
+			inline array_span<const uint8_t> as_binary(uint8_t& subtype) const {
+				if (m_type != 0x05) {
+					subtype = 0;
+					return array_span<const uint8_t>();
+				}
+				subtype = m_value[sizeof(int32_t)];
+				return array_span<const uint8_t>(m_value + sizeof(int32_t) + 1, m_valueSize - sizeof(int32_t) - 1);
+			}
+			//sub-document or array, an empty view for the other types
+			inline bson_view as_document() const {
+				if (m_type == 0x03 || m_type == 0x04) {
+					return bson_view(m_value, m_valueSize, m_type == 0x04);
+				}
+				return bson_view();
+			}
+			inline bson_view as_array() const {
+				return as_document();
+			}
+		private:
+			friend class bson_view;
+			uint8_t m_type = 0;
+			uint32_t m_keyLen = 0;
+			const char* m_key = "";
+			const uint8_t* m_value = nullptr;
+			size_t m_valueSize = 0;
+		};
+
+		class iterator {
+		public:
+			inline bool operator == (const iterator& rhs) const {
+				return m_cur.m_value == rhs.m_cur.m_value;
+			}
+			inline bool operator != (const iterator& rhs) const {
+				return m_cur.m_value != rhs.m_cur.m_value;
+			}
+			inline iterator& operator++() {
+				_read(m_cur.m_value + m_cur.m_valueSize);
+				return *this;
+			}
+			inline iterator operator++(int) {
+				auto rit = *this;
+				++(*this);
+				return rit;
+			}
+			inline auto& operator*() {
+				return *this;
+			}
+			jvalue_type key() const {
+				return m_cur.key();
+			}
+			const element& val() const {
+				return m_cur;
+			}
+		private:
+			friend class bson_view;
+			//decodes the element at p, becomes end() at the terminator or a malformed element
+			void _read(const uint8_t* p) {
+				if (!_readElement(p, m_end, m_cur)) {
+					m_cur = element();
+				}
+			}
+			element m_cur;
+			const uint8_t* m_end = nullptr;
+		};
+
+		//decodes the element starting at p, false at the terminator or if it runs past end
+		static bool _readElement(const uint8_t* p, const uint8_t* end, element& e) {
+			if (p >= end || *p == 0x00) {
+				return false;
+			}
+			auto k = (const uint8_t*)memchr(p + 1, 0, size_t(end - p - 1));
+			if (!k) {
+				return false;
+			}
+			auto v = k + 1;
+			auto n = value_size(*p, v, size_t(end - v));
+			if (n == npos) {
+				return false;
+			}
+			e.m_type = *p;
+			e.m_key = (const char*)p + 1;
+			e.m_keyLen = uint32_t(k - p - 1);
+			e.m_value = v;
+			e.m_valueSize = n;
+			return true;
+		}
+
+		bson_view() {}
+		//len is the bytes available at data, the view is empty if the document header does not fit
+		bson_view(const uint8_t* data, size_t len, bool isArray = false) : m_isArray(isArray) {
+			if (!data || len < 5) {
+				return;
+			}
+			int32_t documentSize = load<int32_t>(data);
+			if (documentSize < 5 || size_t(documentSize) > len) {
+				return;
+			}
+			m_data = data;
+			m_size = size_t(documentSize);
+		}
+		bson_view(const std::vector<uint8_t>& bson, bool isArray = false)
+			: bson_view(bson.data(), bson.size(), isArray) {
+		}
+		bson_view(const jvalue_type& bson, bool isArray = false)
+			: bson_view((const uint8_t*)bson.m_start, bson.get_type() == value_type::string_view_value ? bson.m_len : 0, isArray) {
+		}
+
+		//false if the bytes did not start with a usable document header
+		bool valid() const {
+			return m_data != nullptr;
+		}
+		bool empty() const {
+			return m_size <= 5;
+		}
+		bool is_array() const {
+			return m_isArray;
+		}
+		const uint8_t* data() const {
+			return m_data;
+		}
+		//bytes of the document including its header and terminator
+		size_t bson_size() const {
+			return m_size;
+		}
+		//the document bytes for parse_bson
+		jvalue_type to_viewvalue() const {
+			return jvalue_type((const char*)m_data, uint32_t(m_size));
+		}
+		//builds a json_view tree of the document, pointing into the same bytes
+		void parse(json_view& j) const {
+			if (!valid()) {
+				j = json_view(m_isArray ? json_type::json_array : json_type::json_object);
+				return;
+			}
+			j.parse_bson(to_viewvalue(), m_isArray);
+		}
+
+		//JSON text of the document, straight from the BSON bytes with no json_view in between
+		//types without a JSON counterpart are written as relaxed MongoDB Extended JSON:
+		//{"$oid":"..."}, {"$date":"2024-01-02T03:04:05.678Z"}, {"$binary":{"base64":"...","subType":"00"}} ...
+		std::string dump() const {
+			output_buffer o(m_size + m_size / 2 + 16);
+			dump(o);
+			return o.str();
+		}
+		template <class Writer>
+		void dump(Writer& o) const {
+			o.push_back(m_isArray ? '[' : '{');
+			bool isFirst = true;
+			for (auto it = begin(); it != end() && writer_good(o); ++it) {
+				if (!isFirst) {
+					o.push_back(',');
+				}
+				isFirst = false;
+				const element& e = it.m_cur;
+				if (!m_isArray) {
+					o.push_back('"');
+					write_json_escaped(e.m_key, e.m_keyLen, o);
+					o << "\":";
+				}
+				_dumpElement(e, o);
+			}
+			o.push_back(m_isArray ? ']' : '}');
+		}
+		bool dump_to(const sink_type& sink, size_t bufferSize = sink_buffer::default_size) const {
+			sink_buffer w(sink, bufferSize);
+			dump(w);
+			return w.flush();
+		}
+		bool dump_to(std::ostream& os) const {
+			return dump_to(ostream_sink(os));
+		}
+		//false if the text does not fit in cap, written is then the size needed
+		bool dump_into(char* buf, size_t cap, size_t& written) const {
+			bounded_writer w(buf, cap);
+			dump(w);
+			written = w.size();
+			return !w.overflow();
+		}
+		//exact length of dump()
+		size_t dump_size() const {
+			size_counter c;
+			dump(c);
+			return c.size();
+		}
+
+		iterator begin() const {
+			iterator it;
+			if (!m_data) {
+				return it;
+			}
+			it.m_end = m_data + m_size - 1;
+			it._read(m_data + sizeof(int32_t));
+			return it;
+		}
+		iterator end() const {
+			return iterator();
+		}
+		//walks the elements, O(n)
+		size_t count() const {
+			size_t n = 0;
+			for (auto it = begin(); it != end(); ++it) {
+				++n;
+			}
+			return n;
+		}
+		//first element with the key, compares keys in place without measuring them first
+		iterator find(const char* key, size_t len) const {
+			auto it = begin();
+			for (; it != end(); ++it) {
+				if (it.m_cur.m_keyLen == len && memcmp(it.m_cur.m_key, key, len) == 0) {
+					return it;
+				}
+			}
+			return it;
+		}
+		iterator find(const jvalue_type& key) const {
+			size_t len = 0;
+			const char* s = key.string_data(len);
+			return find(s, len);
+		}
+		iterator find(const std::string& key) const {
+			return find(key.c_str(), key.size());
+		}
+		iterator find(const char* key) const {
+			return find(key, strlen(key));
+		}
+		//the element of the key, invalid if it is missing
+		element operator[](const char* key) const {
+			return find(key).val();
+		}
+		element operator[](const std::string& key) const {
+			return find(key).val();
+		}
+		//index-th element in document order, the keys of an array are not read
+		element at(size_t index) const {
+			auto it = begin();
+			for (; it != end() && index > 0; ++it) {
+				--index;
+			}
+			return it.val();
+		}
+	private:
+		template <class Writer>
+		static void _dumpString(const uint8_t* v, Writer& o) {
+			o.push_back('"');
+			write_json_escaped((const char*)v + sizeof(int32_t), size_t(load<int32_t>(v) - 1), o);
+			o.push_back('"');
+		}
+		template <class Writer>
+		static void _dumpHex(const uint8_t* v, size_t n, Writer& o) {
+			static const char hex[] = "0123456789abcdef";
+			for (size_t i = 0; i < n; ++i) {
+				o.push_back(hex[v[i] >> 4]);
+				o.push_back(hex[v[i] & 0xF]);
+			}
+		}
+		template <class Writer>
+		static void _dumpBase64(const uint8_t* v, size_t n, Writer& o) {
+			static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+			size_t i = 0;
+			for (; i + 3 <= n; i += 3) {
+				uint32_t b = (uint32_t(v[i]) << 16) | (uint32_t(v[i + 1]) << 8) | v[i + 2];
+				char q[4] = { digits[b >> 18], digits[(b >> 12) & 0x3F], digits[(b >> 6) & 0x3F], digits[b & 0x3F] };
+				o.append(q, 4);
+			}
+			if (i < n) {
+				uint32_t b = uint32_t(v[i]) << 16;
+				if (i + 1 < n) {
+					b |= uint32_t(v[i + 1]) << 8;
+				}
+				char q[4] = { digits[b >> 18], digits[(b >> 12) & 0x3F], i + 1 < n ? digits[(b >> 6) & 0x3F] : '=', '=' };
+				o.append(q, 4);
+			}
+		}
+		//ISO-8601 UTC with milliseconds, ms is within years 1970..9999
+		template <class Writer>
+		static void _dumpIsoDate(int64_t ms, Writer& o) {
+			int64_t days = ms / 86400000;
+			int64_t rest = ms % 86400000;
+			//civil date of a day count since 1970-01-01
+			days += 719468;
+			int64_t era = days / 146097;
+			int64_t doe = days - era * 146097;
+			int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+			int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+			int64_t mp = (5 * doy + 2) / 153;
+			int64_t day = doy - (153 * mp + 2) / 5 + 1;
+			int64_t month = mp < 10 ? mp + 3 : mp - 9;
+			int64_t year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+			char d[24] = "0000-00-00T00:00:00.000";
+			auto put = [&d](size_t at, int64_t n, size_t width) {
+				for (size_t i = width; i > 0; --i) {
+					d[at + i - 1] = char('0' + n % 10);
+					n /= 10;
+				}
+			};
+			put(0, year, 4);
+			put(5, month, 2);
+			put(8, day, 2);
+			put(11, rest / 3600000, 2);
+			put(14, rest / 60000 % 60, 2);
+			put(17, rest / 1000 % 60, 2);
+			put(20, rest % 1000, 3);
+			o.push_back('"');
+			o.append(d, 23);
+			o << "Z\"";
+		}
+		//decimal128 as the string form of the BSON decimal128 spec, e.g. 1.23E+10
+		template <class Writer>
+		static void _dumpDecimal128(const uint8_t* v, Writer& o) {
+			uint64_t low = load<uint64_t>(v);
+			uint64_t high = load<uint64_t>(v + 8);
+			uint32_t combination = uint32_t(high >> 58) & 0x1F;
+			//NaN has no sign in Extended JSON
+			if (combination == 31) {
+				o << "NaN";
+				return;
+			}
+			if (high >> 63) {
+				o.push_back('-');
+			}
+			uint32_t biasedExponent = 0;
+			uint32_t significandMsb = 0;
+			if ((combination >> 3) == 3) {
+				if (combination == 30) {
+					o << "Infinity";
+					return;
+				}
+				biasedExponent = uint32_t(high >> 47) & 0x3FFF;
+				significandMsb = 0x8 + (uint32_t(high >> 46) & 0x1);
+			}
+			else {
+				biasedExponent = uint32_t(high >> 49) & 0x3FFF;
+				significandMsb = uint32_t(high >> 46) & 0x7;
+			}
+			int32_t exponent = int32_t(biasedExponent) - 6176;
+			//coefficient in 32-bit parts, most significant first
+			uint32_t parts[4] = { uint32_t(high >> 32) & 0x3FFF, uint32_t(high), uint32_t(low >> 32), uint32_t(low) };
+			parts[0] += significandMsb << 14;
+			uint8_t digits[36] = {};
+			int32_t digitCount = 1;
+			const uint8_t* first = digits + 35;
+			//a coefficient over 34 digits is non-canonical and reads as zero
+			if ((parts[0] | parts[1] | parts[2] | parts[3]) != 0 && parts[0] < (1u << 17)) {
+				for (int k = 3; k >= 0; --k) {
+					uint64_t rem = 0;
+					for (int i = 0; i < 4; ++i) {
+						rem = (rem << 32) + parts[i];
+						parts[i] = uint32_t(rem / 1000000000);
+						rem %= 1000000000;
+					}
+					for (int j = 8; j >= 0; --j) {
+						digits[k * 9 + j] = uint8_t(rem % 10);
+						rem /= 10;
+					}
+				}
+				first = digits;
+				digitCount = 36;
+				while (*first == 0) {
+					++first;
+					--digitCount;
+				}
+			}
+			int32_t scientificExponent = digitCount - 1 + exponent;
+			if (scientificExponent < -6 || exponent > 0) {
+				o.push_back(char('0' + first[0]));
+				if (digitCount > 1) {
+					o.push_back('.');
+					for (int32_t i = 1; i < digitCount; ++i) {
+						o.push_back(char('0' + first[i]));
+					}
+				}
+				o.push_back('E');
+				o.push_back(scientificExponent < 0 ? '-' : '+');
+				from_integer(uint32_t(scientificExponent < 0 ? -scientificExponent : scientificExponent), o);
+				return;
+			}
+			int32_t radix = digitCount + exponent;
+			if (radix > 0) {
+				for (int32_t i = 0; i < radix; ++i) {
+					o.push_back(char('0' + first[i]));
+				}
+			}
+			else {
+				o.push_back('0');
+			}
+			if (exponent < 0) {
+				o.push_back('.');
+				for (int32_t i = radix; i < 0; ++i) {
+					o.push_back('0');
+				}
+				for (int32_t i = radix > 0 ? radix : 0; i < digitCount; ++i) {
+					o.push_back(char('0' + first[i]));
+				}
+			}
+		}
+		template <class Writer>
+		static void _dumpElement(const element& e, Writer& o) {
+			const uint8_t* v = e.m_value;
+			switch (e.m_type) {
+			case 0x01: // double
+			{
+				double d = load<double>(v);
+				if (d != d) {
+					o << "{\"$numberDouble\":\"NaN\"}";
+				}
+				else if (d == std::numeric_limits<double>::infinity()) {
+					o << "{\"$numberDouble\":\"Infinity\"}";
+				}
+				else if (d == -std::numeric_limits<double>::infinity()) {
+					o << "{\"$numberDouble\":\"-Infinity\"}";
+				}
+				else {
+					static write_double f(float_chars_format::general, 0);
+					f(d, o);
+				}
+				return;
+			}
+			case 0x02: // string
+				_dumpString(v, o);
+				return;
+			case 0x03: // object
+			case 0x04: // array
+				e.as_document().dump(o);
+				return;
+			case 0x05: // binary
+			{
+				o << "{\"$binary\":{\"base64\":\"";
+				_dumpBase64(v + sizeof(int32_t) + 1, e.m_valueSize - sizeof(int32_t) - 1, o);
+				o << "\",\"subType\":\"";
+				_dumpHex(v + sizeof(int32_t), 1, o);
+				o << "\"}}";
+				return;
+			}
+			case 0x06: // undefined
+				o << "{\"$undefined\":true}";
+				return;
+			case 0x07: // ObjectId
+				o << "{\"$oid\":\"";
+				_dumpHex(v, 12, o);
+				o << "\"}";
+				return;
+			case 0x08: // boolean
+				if (v[0]) {
+					o << "true";
+				}
+				else {
+					o << "false";
+				}
+				return;
+			case 0x09: // UTC datetime
+			{
+				int64_t ms = load<int64_t>(v);
+				o << "{\"$date\":";
+				if (ms >= 0 && ms <= 253402300799999LL) {
+					_dumpIsoDate(ms, o);
+				}
+				else {
+					o << "{\"$numberLong\":\"";
+					from_integer(ms, o);
+					o << "\"}";
+				}
+				o.push_back('}');
+				return;
+			}
+			case 0x0A: // null
+				o << "null";
+				return;
+			case 0x0B: // regular expression
+			{
+				size_t patternLen = strlen((const char*)v);
+				o << "{\"$regularExpression\":{\"pattern\":\"";
+				write_json_escaped((const char*)v, patternLen, o);
+				o << "\",\"options\":\"";
+				write_json_escaped((const char*)v + patternLen + 1, e.m_valueSize - patternLen - 2, o);
+				o << "\"}}";
+				return;
+			}
+			case 0x0C: // DBPointer
+				o << "{\"$dbPointer\":{\"$ref\":";
+				_dumpString(v, o);
+				o << ",\"$id\":{\"$oid\":\"";
+				_dumpHex(v + e.m_valueSize - 12, 12, o);
+				o << "\"}}}";
+				return;
+			case 0x0D: // JavaScript code
+				o << "{\"$code\":";
+				_dumpString(v, o);
+				o.push_back('}');
+				return;
+			case 0x0E: // symbol
+				o << "{\"$symbol\":";
+				_dumpString(v, o);
+				o.push_back('}');
+				return;
+			case 0x0F: // JavaScript code with scope
+			{
+				const uint8_t* code = v + sizeof(int32_t);
+				const uint8_t* scope = code + sizeof(int32_t) + size_t(load<int32_t>(code));
+				o << "{\"$code\":";
+				_dumpString(code, o);
+				o << ",\"$scope\":";
+				bson_view(scope, size_t(v + e.m_valueSize - scope)).dump(o);
+				o.push_back('}');
+				return;
+			}
+			case 0x10: // int32
+				from_integer(load<int32_t>(v), o);
+				return;
+			case 0x11: // timestamp, increment in the low word
+			{
+				uint64_t ts = load<uint64_t>(v);
+				o << "{\"$timestamp\":{\"t\":";
+				from_integer(uint32_t(ts >> 32), o);
+				o << ",\"i\":";
+				from_integer(uint32_t(ts), o);
+				o << "}}";
+				return;
+			}
+			case 0x12: // int64
+				from_integer(load<int64_t>(v), o);
+				return;
+			case 0x13: // decimal128
+				o << "{\"$numberDecimal\":\"";
+				_dumpDecimal128(v, o);
+				o << "\"}";
+				return;
+			case 0x7F: // max key
+				o << "{\"$maxKey\":1}";
+				return;
+			case 0xFF: // min key
+				o << "{\"$minKey\":1}";
+				return;
+			default:
+				o << "null";
+				return;
+			}
+		}
+		//size is the header value, already known to fit
+		static bool _validateDocument(const uint8_t* data, size_t size, int depth) {
+			if (depth < 1 || data[size - 1] != 0x00) {
+				return false;
+			}
+			const uint8_t* p = data + sizeof(int32_t);
+			const uint8_t* end = data + size - 1;
+			while (p < end) {
+				uint8_t t = *p;
+				auto k = (const uint8_t*)memchr(p + 1, 0, size_t(end - p - 1));
+				if (t == 0x00 || !k) {
+					return false;
+				}
+				auto v = k + 1;
+				auto n = value_size(t, v, size_t(end - v));
+				if (n == npos || !_validateValue(t, v, n, depth)) {
+					return false;
+				}
+				p = v + n;
+			}
+			return true;
+		}
+		static bool _validateString(const uint8_t* v, size_t n) {
+			return n >= sizeof(int32_t) + 1 && size_t(load<int32_t>(v)) + sizeof(int32_t) == n && v[n - 1] == 0x00;
+		}
+		//n is the value_size of the value
+		static bool _validateValue(uint8_t t, const uint8_t* v, size_t n, int depth) {
+			switch (t) {
+			case 0x02: // string
+			case 0x0D: // JavaScript code
+			case 0x0E: // symbol
+				return _validateString(v, n);
+			case 0x0C: // DBPointer
+				return _validateString(v, n - 12);
+			case 0x03: // object
+			case 0x04: // array
+				return _validateDocument(v, n, depth - 1);
+			case 0x08: // boolean
+				return v[0] <= 1;
+			case 0x0F: // JavaScript code with scope, int32 total, string and document
+			{
+				if (n < 14) {
+					return false;
+				}
+				size_t codeSize = sizeof(int32_t) + size_t(uint32_t(load<int32_t>(v + sizeof(int32_t))));
+				if (codeSize > n - sizeof(int32_t) - 5 || !_validateString(v + sizeof(int32_t), codeSize)) {
+					return false;
+				}
+				const uint8_t* scope = v + sizeof(int32_t) + codeSize;
+				size_t scopeSize = n - sizeof(int32_t) - codeSize;
+				return size_t(load<int32_t>(scope)) == scopeSize && _validateDocument(scope, scopeSize, depth - 1);
+			}
+			default:
+				return true;
+			}
+		}
+
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+		bool m_isArray = false;
+	};
+
+	//offsets of the elements of a BSON array or document, built in one walk on demand,
+	//afterwards the i-th element is found without walking the ones before it
+	class bson_array_index {
+	public:
+		static constexpr size_t parallel_min_elements = 1024;
+
+		bson_array_index() {}
+		explicit bson_array_index(const bson_view& v) {
+			build(v);
+		}
+		void build(const bson_view& v) {
+			m_view = v;
+			m_offsets.clear();
+			if (!v.valid()) {
+				return;
+			}
+			const uint8_t* base = v.data();
+			for (auto it = v.begin(); it != v.end(); ++it) {
+				const bson_view::element& e = it.val();
+				m_offsets.push_back(uint32_t(e.key().m_start - 1 - (const char*)base));
+			}
+		}
+		size_t size() const {
+			return m_offsets.size();
+		}
+		bool empty() const {
+			return m_offsets.empty();
+		}
+		const bson_view& view() const {
+			return m_view;
+		}
+		//invalid element past the end
+		bson_view::element operator[](size_t i) const {
+			bson_view::element e;
+			if (i < m_offsets.size()) {
+				bson_view::_readElement(m_view.data() + m_offsets[i], m_view.data() + m_view.bson_size() - 1, e);
+			}
+			return e;
+		}
+		bson_view::element at(size_t i) const {
+			return (*this)[i];
+		}
+		//calls f(i, element) for every element on threads (0: one per core) pulling chunks of
+		//the index, small arrays run on the calling thread, f must be safe to call concurrently
+		//the first exception thrown by f stops the chunks and is rethrown once the threads are joined
+		template <class F>
+		void for_each_parallel(const F& f, size_t threads = 0) const {
+			if (threads == 0) {
+				threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+			}
+			size_t s = size();
+			if (threads < 2 || s < parallel_min_elements) {
+				_forRange(f, 0, s);
+				return;
+			}
+			//several chunks per thread even out uneven elements
+			size_t chunkCount = std::min(s, threads * 8);
+			std::atomic<size_t> next(0);
+			std::atomic<bool> stop(false);
+			//the first exception of f, rethrown here once every thread has stopped
+			std::exception_ptr error;
+			std::mutex m;
+			auto work = [&]() {
+				while (!stop) {
+					size_t i = next++;
+					if (i >= chunkCount) {
+						return;
+					}
+					try {
+						_forRange(f, s * i / chunkCount, s * (i + 1) / chunkCount);
+					}
+					catch (...) {
+						std::lock_guard<std::mutex> l(m);
+						if (!error) {
+							error = std::current_exception();
+						}
+						stop = true;
+					}
+				}
+			};
+			std::vector<std::thread> pool;
+			auto finish = [&]() {
+				stop = true;
+				for (auto& t : pool) {
+					t.join();
+				}
+			};
+			try {
+				pool.reserve(threads - 1);
+				for (size_t t = 1; t < threads; ++t) {
+					pool.emplace_back(work);
+				}
+			}
+			catch (...) {
+				finish();
+				throw;
+			}
+			work();
+			finish();
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+	private:
+		template <class F>
+		void _forRange(const F& f, size_t begin, size_t end) const {
+			for (size_t i = begin; i < end; ++i) {
+				f(i, (*this)[i]);
+			}
+		}
+		bson_view m_view;
+		std::vector<uint32_t> m_offsets;
+	};
+
+	//appends to a byte vector through a raw pointer, container lengths are patched in when they close
+	class bson_buffer {
+	public:
+		using value_type = char;
+		bson_buffer(std::vector<uint8_t>& out) : m_out(out) {
+			size_t used = m_out.size();
+			m_out.resize(used + 256);
+			m_cur = m_out.data() + used;
+			m_end = m_out.data() + m_out.size();
+		}
+		bson_buffer(const bson_buffer&) = delete;
+		bson_buffer& operator=(const bson_buffer&) = delete;
+		//trims the vector to the written bytes
+		~bson_buffer() {
+			m_out.resize(size());
+		}
+		inline size_t size() const {
+			return size_t(m_cur - m_out.data());
+		}
+		inline void reserve(size_t n) {
+			if (size_t(m_end - m_cur) < n) {
+				_grow(n);
+			}
+		}
+		inline void push_back(char c) {
+			if (m_cur == m_end) {
+				_grow(1);
+			}
+			*m_cur++ = uint8_t(c);
+		}
+		inline void append(const char* s, size_t n) {
+			reserve(n);
+			memcpy(m_cur, s, n);
+			m_cur += n;
+		}
+		inline void append(char c, size_t n) {
+			reserve(n);
+			memset(m_cur, c, n);
+			m_cur += n;
+		}
+		//overwrites the int32 at offset at, a length written as a placeholder earlier
+		inline void patch_int32(size_t at, int32_t v) {
+			uint8_t* p = m_out.data() + at;
+			memcpy(p, &v, sizeof(v));
+			if (!json_view::little_endianness()) {
+				std::reverse(p, p + sizeof(v));
+			}
+		}
+		inline void patch_byte(size_t at, uint8_t b) {
+			m_out[at] = b;
+		}
+		//drops everything after offset at
+		inline void truncate(size_t at) {
+			m_cur = m_out.data() + at;
+		}
+	private:
+		void _grow(size_t n) {
+			size_t used = size();
+			size_t cap = m_out.size() * 2;
+			if (cap < used + n) {
+				cap = used + n;
+			}
+			m_out.resize(cap);
+			m_cur = m_out.data() + used;
+			m_end = m_out.data() + cap;
+		}
+		std::vector<uint8_t>& m_out;
+		uint8_t* m_cur = nullptr;
+		uint8_t* m_end = nullptr;
+	};
+
+	template <size_t N>
+	inline bson_buffer& operator << (bson_buffer& o, const char(&s)[N]) {
+		o.append(s, N - 1);
+		return o;
+	}
+
+	inline bson_buffer& operator << (bson_buffer& o, const viewvalue& v) {
+		return v.write_to(o);
+	}
+
+	//JSON text to BSON in one pass over the text, no json_view tree is built
+	//the text has to be RFC 8259 JSON as is_valid_json checks it, unlike parse there are no single quotes,
+	//bare words or trailing commas, and only whitespace may follow the top-level object or array
+	//scalars are typed as parse(json, false, flags) types them, so the bytes are those of parse + dump_bson
+	class bson_encoder {
+	public:
+		//appends the BSON of the object or array in json to o, false and o unchanged if json is not valid
+		static bool encode(const char* json, std::vector<uint8_t>& o, uint32_t flags = parse_none, int maxDepth = 100) {
+			size_t oldSize = o.size();
+			const char* jend = json + strlen(json);
+			const char* end = nullptr;
+			{
+				bson_buffer w(o);
+				json = json_view::_skipJsonSpace(json, jend);
+				if (*json == '{') {
+					end = _encodeObject(json, jend, w, flags, maxDepth);
+				}
+				else if (*json == '[') {
+					end = _encodeArray(json, jend, w, flags, maxDepth);
+				}
+				if (end && json_view::_skipJsonSpace(end, jend) != jend) {
+					end = nullptr;
+				}
+				if (!end) {
+					w.truncate(oldSize);
+				}
+			}
+			return end != nullptr;
+		}
+
+		static const char* _encodeObject(const char* jdata, const char* jend, bson_buffer& w, uint32_t flags, int depth) {
+			if (depth <= 0) {
+				return nullptr;
+			}
+			size_t start = w.size();
+			w.append('\0', sizeof(int32_t));
+			++jdata;
+			jdata = json_view::_skipJsonSpace(jdata, jend);
+			if (*jdata == '}') {
+				++jdata;
+				return _close(jdata, w, start);
+			}
+			while (true) {
+				const char* key = jdata;
+				if (*jdata != '"' || !json_view::_validateJsonString(jdata, jend)) {
+					return nullptr;
+				}
+				size_t keyLen = size_t(jdata - key) - 2;
+				jdata = json_view::_skipJsonSpace(jdata, jend);
+				if (*jdata != ':') {
+					return nullptr;
+				}
+				++jdata;
+				jdata = json_view::_skipJsonSpace(jdata, jend);
+				size_t typeAt = w.size();
+				w.push_back('\0');
+				write_json_unescaped(key + 1, keyLen, w);
+				w.push_back('\0');
+				jdata = _encodeValue(jdata, jend, w, typeAt, flags, depth);
+				if (!jdata) {
+					return nullptr;
+				}
+				jdata = json_view::_skipJsonSpace(jdata, jend);
+				if (*jdata == ',') {
+					++jdata;
+					jdata = json_view::_skipJsonSpace(jdata, jend);
+					continue;
+				}
+				if (*jdata == '}') {
+					++jdata;
+					return _close(jdata, w, start);
+				}
+				return nullptr;
+			}
+		}
+		static const char* _encodeArray(const char* jdata, const char* jend, bson_buffer& w, uint32_t flags, int depth) {
+			if (depth <= 0) {
+				return nullptr;
+			}
+			size_t start = w.size();
+			w.append('\0', sizeof(int32_t));
+			++jdata;
+			jdata = json_view::_skipJsonSpace(jdata, jend);
+			if (*jdata == ']') {
+				++jdata;
+				return _close(jdata, w, start);
+			}
+			uint32_t i = 0;
+			while (true) {
+				size_t typeAt = w.size();
+				w.push_back('\0');
+				bson_index_keys::write(i++, w);
+				jdata = _encodeValue(jdata, jend, w, typeAt, flags, depth);
+				if (!jdata) {
+					return nullptr;
+				}
+				jdata = json_view::_skipJsonSpace(jdata, jend);
+				if (*jdata == ',') {
+					++jdata;
+					jdata = json_view::_skipJsonSpace(jdata, jend);
+					continue;
+				}
+				if (*jdata == ']') {
+					++jdata;
+					return _close(jdata, w, start);
+				}
+				return nullptr;
+			}
+		}
+		//writes the value at jdata and sets the type byte of its element at typeAt
+		static const char* _encodeValue(const char* jdata, const char* jend, bson_buffer& w, size_t typeAt, uint32_t flags, int depth) {
+			if (*jdata == '{') {
+				w.patch_byte(typeAt, 0x03);
+				return _encodeObject(jdata, jend, w, flags, depth - 1);
+			}
+			if (*jdata == '[') {
+				w.patch_byte(typeAt, 0x04);
+				return _encodeArray(jdata, jend, w, flags, depth - 1);
+			}
+			//the scalar is checked strictly, then resolved by a json_view on the stack, nothing is allocated for it
+			const char* start = jdata;
+			if (!json_view::_validateJsonValue(jdata, jend, 1)) {
+				return nullptr;
+			}
+			json_view t;
+			t.m_value = viewvalue(start, uint32_t(jdata - start));
+			t.m_type = json_type::json_lazy;
+			if (flags & parse_bigdec) {
+				t.m_flags |= json_view::flag_bigdec;
+			}
+			if (flags & parse_float32) {
+				t.m_flags |= json_view::flag_float32;
+			}
+			uint8_t btype = t.check_type() ? t.get_bson_type() : 0;
+			if (btype == 0) {
+				return nullptr;
+			}
+			w.patch_byte(typeAt, btype);
+			const uint32_t* sizes = nullptr;
+			t._dumpBson(w, btype, sizes);
+			return jdata;
+		}
+		static const char* _close(const char* jdata, bson_buffer& w, size_t start) {
+			w.push_back('\0');
+			w.patch_int32(start, int32_t(w.size() - start));
+			return jdata;
+		}
+	};
+
+	//appends the BSON of json to o, false and o unchanged if json is not one JSON object or array,
+	//see bson_encoder for the grammar
+	inline bool json_to_bson(const char* json, std::vector<uint8_t>& o, uint32_t flags = parse_none) {
+		return bson_encoder::encode(json, o, flags);
+	}
+	inline std::vector<uint8_t> json_to_bson(const char* json, uint32_t flags = parse_none) {
+		std::vector<uint8_t> o;
+		bson_encoder::encode(json, o, flags);
+		return o;
+	}
+
+	//one linear pass over untrusted bytes before the unchecked parse_bson or bson_view reads them
+	inline bool validate_bson(const uint8_t* data, size_t len, int maxDepth = 100) {
+		return bson_view::validate(data, len, maxDepth);
+	}
+	inline bool validate_bson(const std::vector<uint8_t>& bson, int maxDepth = 100) {
+		return bson_view::validate(bson.data(), bson.size(), maxDepth);
+	}
+}
+
+#endif
@@ -11,6 +11,30 @@
 #include <iostream>
 #include <array>
 #include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NICEHERO_HAS_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NICEHERO_HAS_SSE2 1
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <iterator>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#endif
 
 namespace nicehero
 {
@@ -25,8 +49,23 @@ namespace nicehero
 		json_object,
 		json_boolean,
 		json_delete,
-		json_lazy
+		json_lazy,
+		json_typed_array,
+		json_int128,
+		json_bignum,
+		json_float,
+		json_raw
     };
+
+	enum parse_flags : uint32_t
+	{
+		parse_none = 0,
+		parse_typed_array = 0x01, //arrays of only int64 or double are stored in a typed_array
+		parse_raw_number = 0x02, //numbers keep their source text and dump writes it back unchanged
+		parse_bigdec = 0x04, //decimals with more than 17 significant digits are kept as bigdec text
+		parse_float32 = 0x08, //decimals are parsed to float instead of double
+		parse_keep_source = 0x10, //objects and arrays keep their source text, dump copies it while they are unchanged
+	};
 	
 	enum class semantic_tag : uint8_t 
 	{
@@ -53,12 +92,737 @@ namespace nicehero
 		code = 0x14,
 		mongo_timestamp = 0x15,
 		mongo_number_int = 0x16,
+		fixed1 = 0x21, //double dumped with a fixed number of decimals, fixed1..fixed9
+		fixed2 = 0x22,
+		fixed3 = 0x23,
+		fixed4 = 0x24,
+		fixed5 = 0x25,
+		fixed6 = 0x26,
+		fixed7 = 0x27,
+		fixed8 = 0x28,
+		fixed9 = 0x29,
+	};
+
+	//escape letter of each byte in a JSON string, 0 if it is copied as is, 'u' for control bytes without a short escape
+	inline const char* json_escape_table() {
+		struct table {
+			char m_esc[256];
+			table() {
+				memset(m_esc, 0, sizeof(m_esc));
+				for (int c = 0; c < 0x20; ++c) {
+					m_esc[c] = 'u';
+				}
+				m_esc[uint8_t('\b')] = 'b';
+				m_esc[uint8_t('\f')] = 'f';
+				m_esc[uint8_t('\n')] = 'n';
+				m_esc[uint8_t('\r')] = 'r';
+				m_esc[uint8_t('\t')] = 't';
+				m_esc[uint8_t('"')] = '"';
+				m_esc[uint8_t('\\')] = '\\';
+			}
+		};
+		static const table t;
+		return t.m_esc;
+	}
+
+	inline uint32_t _lowestBit(uint32_t mask) {
+#if defined(_MSC_VER)
+		unsigned long r;
+		_BitScanForward(&r, mask);
+		return uint32_t(r);
+#else
+		return uint32_t(__builtin_ctz(mask));
+#endif
+	}
+
+	//offset of the first byte of s[0, n) that needs escaping, n if there is none.
+	//whole 32 or 16 byte blocks are tested with one compare, the tail byte by byte
+	inline size_t find_json_escape(const char* s, size_t n) {
+		size_t i = 0;
+#if defined(NICEHERO_HAS_AVX2)
+		const __m256i quote32 = _mm256_set1_epi8('"');
+		const __m256i backslash32 = _mm256_set1_epi8('\\');
+		const __m256i control32 = _mm256_set1_epi8(0x1F);
+		for (; i + 32 <= n; i += 32) {
+			__m256i x = _mm256_loadu_si256((const __m256i*)(s + i));
+			__m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(x, quote32), _mm256_cmpeq_epi8(x, backslash32));
+			m = _mm256_or_si256(m, _mm256_cmpeq_epi8(_mm256_min_epu8(x, control32), x));
+			uint32_t mask = uint32_t(_mm256_movemask_epi8(m));
+			if (mask != 0) {
+				return i + _lowestBit(mask);
+			}
+		}
+#endif
+#if defined(NICEHERO_HAS_SSE2)
+		const __m128i quote16 = _mm_set1_epi8('"');
+		const __m128i backslash16 = _mm_set1_epi8('\\');
+		const __m128i control16 = _mm_set1_epi8(0x1F);
+		for (; i + 16 <= n; i += 16) {
+			__m128i x = _mm_loadu_si128((const __m128i*)(s + i));
+			__m128i m = _mm_or_si128(_mm_cmpeq_epi8(x, quote16), _mm_cmpeq_epi8(x, backslash16));
+			m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_min_epu8(x, control16), x));
+			uint32_t mask = uint32_t(_mm_movemask_epi8(m));
+			if (mask != 0) {
+				return i + _lowestBit(mask);
+			}
+		}
+#endif
+		const char* esc = json_escape_table();
+		for (; i < n; ++i) {
+			if (esc[uint8_t(s[i])]) {
+				return i;
+			}
+		}
+		return n;
+	}
+
+	//writes s[0, n) as the inside of a JSON string, clean runs are appended in one piece
+	template <class Writer>
+	inline void write_json_escaped(const char* s, size_t n, Writer& w) {
+		static const char hex[] = "0123456789abcdef";
+		const char* esc = json_escape_table();
+		size_t i = 0;
+		while (i < n) {
+			size_t clean = find_json_escape(s + i, n - i);
+			w.append(s + i, clean);
+			i += clean;
+			if (i >= n) {
+				break;
+			}
+			uint8_t c = uint8_t(s[i]);
+			if (esc[c] == 'u') {
+				char u[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+				w.append(u, 6);
+			}
+			else {
+				char e[2] = { '\\', esc[c] };
+				w.append(e, 2);
+			}
+			++i;
+		}
+	}
+
+	//value of 4 hex digits, false if s does not start with them
+	inline bool json_hex4(const char* s, size_t len, uint32_t& r) {
+		if (len < 4) {
+			return false;
+		}
+		r = 0;
+		for (size_t i = 0; i < 4; ++i) {
+			char c = s[i];
+			r <<= 4;
+			if (c >= '0' && c <= '9') {
+				r |= uint32_t(c - '0');
+			}
+			else if (c >= 'a' && c <= 'f') {
+				r |= uint32_t(c - 'a' + 10);
+			}
+			else if (c >= 'A' && c <= 'F') {
+				r |= uint32_t(c - 'A' + 10);
+			}
+			else {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//writes the text of the inside of a JSON string s[0, n) with its escapes decoded, \u as UTF-8
+	template <class Writer>
+	inline void write_json_unescaped(const char* s, size_t n, Writer& w) {
+		size_t i = 0;
+		while (i < n) {
+			const char* slash = (const char*)memchr(s + i, '\\', n - i);
+			size_t clean = slash ? size_t(slash - s) - i : n - i;
+			w.append(s + i, clean);
+			i += clean;
+			if (i >= n) {
+				break;
+			}
+			if (i + 1 >= n) {
+				w.push_back('\\');
+				break;
+			}
+			char c = s[++i];
+			switch (c) {
+			case 'b': w.push_back('\b'); break;
+			case 'f': w.push_back('\f'); break;
+			case 'n': w.push_back('\n'); break;
+			case 'r': w.push_back('\r'); break;
+			case 't': w.push_back('\t'); break;
+			case 'u': {
+				uint32_t cp = 0;
+				if (!json_hex4(s + i + 1, n - i - 1, cp)) {
+					w.push_back(c);
+					break;
+				}
+				i += 4;
+				uint32_t lo = 0;
+				if (cp >= 0xD800 && cp < 0xDC00 && i + 2 < n && s[i + 1] == '\\' && s[i + 2] == 'u'
+					&& json_hex4(s + i + 3, n - i - 3, lo) && lo >= 0xDC00 && lo < 0xE000) {
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+					i += 6;
+				}
+				if (cp < 0x80) {
+					w.push_back(char(cp));
+				}
+				else if (cp < 0x800) {
+					w.push_back(char(0xC0 | (cp >> 6)));
+					w.push_back(char(0x80 | (cp & 0x3F)));
+				}
+				else if (cp < 0x10000) {
+					w.push_back(char(0xE0 | (cp >> 12)));
+					w.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+					w.push_back(char(0x80 | (cp & 0x3F)));
+				}
+				else {
+					w.push_back(char(0xF0 | (cp >> 18)));
+					w.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+					w.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+					w.push_back(char(0x80 | (cp & 0x3F)));
+				}
+				break;
+			}
+			default: w.push_back(c); break;
+			}
+			++i;
+		}
+	}
+
+	//append buffer for dump, writes through a raw pointer and grows geometrically
+	class output_buffer {
+	public:
+		using value_type = char;
+		output_buffer(size_t reserve_ = 256) {
+			m_str.resize(reserve_ > 0 ? reserve_ : 1);
+			m_cur = &m_str[0];
+			m_end = m_cur + m_str.size();
+		}
+		output_buffer(const output_buffer&) = delete;
+		output_buffer& operator=(const output_buffer&) = delete;
+
+		inline size_t size() const {
+			return size_t(m_cur - m_str.data());
+		}
+		inline const char* data() const {
+			return m_str.data();
+		}
+		//makes room for n more bytes
+		inline void reserve(size_t n) {
+			if (size_t(m_end - m_cur) < n) {
+				_grow(n);
+			}
+		}
+		inline void push_back(char c) {
+			if (m_cur == m_end) {
+				_grow(1);
+			}
+			*m_cur++ = c;
+		}
+		inline void append(const char* s, size_t n) {
+			reserve(n);
+			memcpy(m_cur, s, n);
+			m_cur += n;
+		}
+		inline void append(char c, size_t n) {
+			reserve(n);
+			memset(m_cur, c, n);
+			m_cur += n;
+		}
+		//hands the written bytes over, the buffer is empty afterwards
+		std::string str() {
+			m_str.resize(size());
+			std::string r;
+			r.swap(m_str);
+			m_cur = m_end = nullptr;
+			return r;
+		}
+	private:
+		void _grow(size_t n) {
+			size_t used = size();
+			size_t cap = m_str.size() * 2;
+			if (cap < used + n) {
+				cap = used + n;
+			}
+			m_str.resize(cap);
+			m_cur = &m_str[0] + used;
+			m_end = &m_str[0] + cap;
+		}
+		std::string m_str;
+		char* m_cur = nullptr;
+		char* m_end = nullptr;
+	};
+
+	template <size_t N>
+	inline output_buffer& operator << (output_buffer& o, const char(&s)[N]) {
+		o.append(s, N - 1);
+		return o;
+	}
+
+	inline output_buffer& operator << (output_buffer& o, const viewvalue& v) {
+		return v.write_to(o);
+	}
+
+	//stands in for output_buffer to measure the output without writing it
+	class size_counter {
+	public:
+		using value_type = char;
+		inline size_t size() const {
+			return m_size;
+		}
+		inline void reserve(size_t) {
+		}
+		inline void push_back(char) {
+			++m_size;
+		}
+		inline void append(const char*, size_t n) {
+			m_size += n;
+		}
+		inline void append(char, size_t n) {
+			m_size += n;
+		}
+	private:
+		size_t m_size = 0;
+	};
+
+	template <size_t N>
+	inline size_counter& operator << (size_counter& o, const char(&)[N]) {
+		o.append(nullptr, N - 1);
+		return o;
+	}
+
+	inline size_counter& operator << (size_counter& o, const viewvalue& v) {
+		return v.write_to(o);
+	}
+
+	//stores straight into memory the caller has measured, e.g. with size_counter, no bounds checks
+	class raw_writer {
+	public:
+		using value_type = char;
+		raw_writer(void* buf) : m_start((char*)buf), m_cur((char*)buf) {
+		}
+		inline size_t size() const {
+			return size_t(m_cur - m_start);
+		}
+		inline void reserve(size_t) {
+		}
+		inline void push_back(char c) {
+			*m_cur++ = c;
+		}
+		inline void append(const char* s, size_t n) {
+			memcpy(m_cur, s, n);
+			m_cur += n;
+		}
+		inline void append(char c, size_t n) {
+			memset(m_cur, c, n);
+			m_cur += n;
+		}
+	private:
+		char* m_start;
+		char* m_cur;
+	};
+
+	template <size_t N>
+	inline raw_writer& operator << (raw_writer& o, const char(&s)[N]) {
+		o.append(s, N - 1);
+		return o;
+	}
+
+	inline raw_writer& operator << (raw_writer& o, const viewvalue& v) {
+		return v.write_to(o);
+	}
+
+	//decimal keys of BSON array elements, "0\0" to "9999\0" one after another in a table built
+	//on first use, the place of a key follows from its digit count so no offsets are stored
+	class bson_index_keys {
+	public:
+		static constexpr uint32_t count = 10000;
+		static constexpr size_t table_size = 10 * 2 + 90 * 3 + 900 * 4 + 9000 * 5;
+
+		//"i\0" for i < count, len includes the NUL
+		static inline const char* get(uint32_t i, size_t& len) {
+			static const table t;
+			if (i < 10) {
+				len = 2;
+				return t.m_keys + i * 2;
+			}
+			if (i < 100) {
+				len = 3;
+				return t.m_keys + 20 + (i - 10) * 3;
+			}
+			if (i < 1000) {
+				len = 4;
+				return t.m_keys + 290 + (i - 100) * 4;
+			}
+			len = 5;
+			return t.m_keys + 3890 + (i - 1000) * 5;
+		}
+		//writes the key of element i with its NUL, past the table the low 4 digits still come from it
+		template <class Writer>
+		static inline void write(uint32_t i, Writer& w) {
+			size_t len = 0;
+			if (i < count) {
+				const char* key = get(i, len);
+				w.append(key, len);
+				return;
+			}
+			if (i < count * count) {
+				const char* hi = get(i / count, len);
+				w.append(hi, len - 1);
+				const char* lo = get(i % count, len);
+				w.append('0', 5 - len);
+				w.append(lo, len);
+				return;
+			}
+			from_integer(i, w);
+			w.push_back('\0');
+		}
+		//bytes of the keys of elements 0 to n - 1 with their NULs
+		static inline size_t total_size(size_t n) {
+			size_t r = 0;
+			size_t lo = 0;
+			size_t hi = 10;
+			for (size_t len = 2; lo < n; ++len) {
+				r += (std::min(n, hi) - lo) * len;
+				lo = hi;
+				hi *= 10;
+			}
+			return r;
+		}
+	private:
+		struct table {
+			char m_keys[table_size];
+			table() {
+				char* p = m_keys;
+				for (uint32_t i = 0; i < count; ++i) {
+					raw_writer w(p);
+					from_integer(i, w);
+					w.push_back('\0');
+					p += w.size();
+				}
+			}
+		};
+	};
+
+	//writes into a fixed buffer, once something does not fit it only counts the bytes
+	class bounded_writer {
+	public:
+		using value_type = char;
+		bounded_writer(char* buf, size_t cap) : m_start(buf), m_cur(buf), m_end(buf + cap) {
+		}
+		//bytes the whole output takes, written or not
+		inline size_t size() const {
+			return size_t(m_cur - m_start) + m_over;
+		}
+		inline bool overflow() const {
+			return m_over > 0;
+		}
+		inline void reserve(size_t) {
+		}
+		inline void push_back(char c) {
+			if (m_over == 0 && m_cur != m_end) {
+				*m_cur++ = c;
+				return;
+			}
+			++m_over;
+		}
+		inline void append(const char* s, size_t n) {
+			if (m_over == 0 && size_t(m_end - m_cur) >= n) {
+				memcpy(m_cur, s, n);
+				m_cur += n;
+				return;
+			}
+			m_over += n;
+		}
+		inline void append(char c, size_t n) {
+			if (m_over == 0 && size_t(m_end - m_cur) >= n) {
+				memset(m_cur, c, n);
+				m_cur += n;
+				return;
+			}
+			m_over += n;
+		}
+	private:
+		char* m_start;
+		char* m_cur;
+		char* m_end;
+		size_t m_over = 0;
+	};
+
+	template <size_t N>
+	inline bounded_writer& operator << (bounded_writer& o, const char(&s)[N]) {
+		o.append(s, N - 1);
+		return o;
+	}
+
+	inline bounded_writer& operator << (bounded_writer& o, const viewvalue& v) {
+		return v.write_to(o);
+	}
+
+	//destination of dump_to and dump_bson_to, returns false to stop the output
+	using sink_type = std::function<bool(const char*, size_t)>;
+
+	inline sink_type ostream_sink(std::ostream& os) {
+		return [&os](const char* s, size_t n) {
+			os.write(s, std::streamsize(n));
+			return bool(os);
+		};
+	}
+
+	//writes to a file descriptor, retrying short writes
+	inline sink_type fd_sink(int fd) {
+		return [fd](const char* s, size_t n) {
+			while (n > 0) {
+#if defined(_WIN32)
+				int w = _write(fd, s, unsigned(n > 0x40000000 ? 0x40000000 : n));
+#else
+				ssize_t w = ::write(fd, s, n);
+				if (w < 0 && errno == EINTR) {
+					continue;
+				}
+#endif
+				if (w <= 0) {
+					return false;
+				}
+				s += w;
+				n -= size_t(w);
+			}
+			return true;
+		};
+	}
+
+	//fixed-size buffer in front of a sink, handed over each time it fills up
+	class sink_buffer {
+	public:
+		using value_type = char;
+		static constexpr size_t default_size = 64 * 1024;
+		sink_buffer(const sink_type& sink, size_t capacity = default_size)
+			: m_sink(sink), m_buf(capacity > 64 ? capacity : 64) {
+			m_cur = m_buf.data();
+			m_end = m_cur + m_buf.size();
+		}
+		sink_buffer(const sink_buffer&) = delete;
+		sink_buffer& operator=(const sink_buffer&) = delete;
+
+		inline void reserve(size_t n) {
+			if (size_t(m_end - m_cur) < n) {
+				flush();
+			}
+		}
+		inline void push_back(char c) {
+			if (m_cur == m_end) {
+				flush();
+			}
+			*m_cur++ = c;
+		}
+		inline void append(const char* s, size_t n) {
+			if (size_t(m_end - m_cur) < n) {
+				flush();
+				if (n >= m_buf.size()) {
+					_write(s, n);
+					return;
+				}
+			}
+			memcpy(m_cur, s, n);
+			m_cur += n;
+		}
+		inline void append(char c, size_t n) {
+			while (n > 0) {
+				if (m_cur == m_end) {
+					flush();
+				}
+				size_t k = std::min(n, size_t(m_end - m_cur));
+				memset(m_cur, c, k);
+				m_cur += k;
+				n -= k;
+			}
+		}
+		//hands the buffered bytes to the sink, false once the sink has failed
+		bool flush() {
+			if (m_cur != m_buf.data()) {
+				_write(m_buf.data(), size_t(m_cur - m_buf.data()));
+				m_cur = m_buf.data();
+			}
+			return m_good;
+		}
+		inline bool good() const {
+			return m_good;
+		}
+	private:
+		void _write(const char* s, size_t n) {
+			if (m_good && !m_sink(s, n)) {
+				m_good = false;
+			}
+		}
+		const sink_type& m_sink;
+		std::vector<char> m_buf;
+		char* m_cur = nullptr;
+		char* m_end = nullptr;
+		bool m_good = true;
+	};
+
+	template <size_t N>
+	inline sink_buffer& operator << (sink_buffer& o, const char(&s)[N]) {
+		o.append(s, N - 1);
+		return o;
+	}
+
+	inline sink_buffer& operator << (sink_buffer& o, const viewvalue& v) {
+		return v.write_to(o);
+	}
+
+	//false once output to the writer is thrown away, dumps stop walking the document then
+	template <class Writer>
+	inline bool writer_good(const Writer&) {
+		return true;
+	}
+	inline bool writer_good(const sink_buffer& w) {
+		return w.good();
+	}
+
+	//layout of pretty dumps
+	struct pretty_options {
+		char indent_char = '\t';
+		uint8_t indent_width = 1; //indent_char repeats per level
+		bool crlf = false; //"\r\n" line ends instead of "\n"
+		bool compact_scalar_arrays = false; //arrays without objects or arrays inside stay on one line
+	};
+
+	//settings of one dump, m_run is a line end followed by the indentation of the first levels
+	struct dump_style {
+		static constexpr size_t run_size = 256;
+		bool m_pretty = false;
+		bool m_compactScalarArrays = false;
+		int m_fixedPrecision = 0;
+		char m_indentChar = '\t';
+		size_t m_indentWidth = 1;
+		size_t m_newlineLen = 1;
+		size_t m_runLen = 0;
+		char m_run[run_size];
+
+		dump_style(int format_, int fixedPrecision) : m_pretty(format_ > 0), m_fixedPrecision(fixedPrecision) {
+			_fillRun();
+		}
+		dump_style(const pretty_options& options, int fixedPrecision)
+			: m_pretty(true), m_compactScalarArrays(options.compact_scalar_arrays), m_fixedPrecision(fixedPrecision)
+			, m_indentChar(options.indent_char), m_indentWidth(options.indent_width), m_newlineLen(options.crlf ? 2 : 1) {
+			_fillRun();
+		}
+		//bytes of a line break followed by the indentation of layer
+		inline size_t line_size(size_t layer) const {
+			return m_pretty ? m_newlineLen + layer * m_indentWidth : 0;
+		}
+		template <class Writer>
+		inline void new_line(Writer& vl, size_t layer) const {
+			size_t n = m_newlineLen + layer * m_indentWidth;
+			if (n <= m_runLen) {
+				vl.append(m_run, n);
+				return;
+			}
+			vl.append(m_run, m_runLen);
+			vl.append(m_indentChar, n - m_runLen);
+		}
+	private:
+		void _fillRun() {
+			if (m_newlineLen == 2) {
+				m_run[0] = '\r';
+				m_run[1] = '\n';
+			}
+			else {
+				m_run[0] = '\n';
+			}
+			memset(m_run + m_newlineLen, m_indentChar, run_size - m_newlineLen);
+			m_runLen = run_size;
+		}
+	};
+
+	//view of contiguous elements
+	template <class T>
+	class array_span {
+	public:
+		array_span() {}
+		array_span(T* data_, size_t size_) : m_data(data_), m_size(size_) {}
+		T* data() const {
+			return m_data;
+		}
+		size_t size() const {
+			return m_size;
+		}
+		bool empty() const {
+			return m_size == 0;
+		}
+		T* begin() const {
+			return m_data;
+		}
+		T* end() const {
+			return m_data + m_size;
+		}
+		T& operator[](size_t i) const {
+			return m_data[i];
+		}
+	private:
+		T* m_data = nullptr;
+		size_t m_size = 0;
+	};
+
+	//array storage of only int64, only double or only float elements
+	class typed_array {
+	public:
+		json_type m_elem_type = json_type::json_int64;
+		std::vector<int64_t> m_int64s;
+		std::vector<double> m_doubles;
+		std::vector<float> m_floats;
+
+		size_t size() const {
+			if (m_elem_type == json_type::json_double) {
+				return m_doubles.size();
+			}
+			if (m_elem_type == json_type::json_float) {
+				return m_floats.size();
+			}
+			return m_int64s.size();
+		}
+		void to_float() {
+			if (m_elem_type == json_type::json_float) {
+				return;
+			}
+			m_floats.reserve(m_int64s.capacity());
+			for (auto v : m_int64s) {
+				m_floats.push_back(float(v));
+			}
+			std::vector<int64_t>().swap(m_int64s);
+			m_elem_type = json_type::json_float;
+		}
+		void to_double() {
+			if (m_elem_type == json_type::json_double) {
+				return;
+			}
+			m_doubles.reserve(m_int64s.capacity());
+			for (auto v : m_int64s) {
+				m_doubles.push_back(double(v));
+			}
+			std::vector<int64_t>().swap(m_int64s);
+			m_elem_type = json_type::json_double;
+		}
 	};
 	class json_view{
 	public:
 		using jvalue_type = viewvalue;
 		using keys_type = std::unordered_map<jvalue_type, uint32_t>;
 		using kjson_view = std::pair<jvalue_type, json_view>;
+		//members of an object or elements of an array, m_source is the parse_keep_source text
+		//a json_raw value keeps its text in m_source with no elements
+		struct container_type : public std::vector<kjson_view> {
+			using std::vector<kjson_view>::vector;
+			const char* m_source = nullptr;
+			size_t m_sourceLen = 0;
+			std::shared_ptr<const std::string> m_keep; //owns m_source when a raw fragment was copied
+		};
+		//m_flags bits
+		static constexpr uint8_t flag_raw_number = 0x01;
+		static constexpr uint8_t flag_bigdec = 0x02;
+		static constexpr uint8_t flag_float32 = 0x04;
+		static constexpr uint8_t flag_bson_verbatim = 0x08; //parsed from a BSON type JSON has no match for or int32, m_rawlen is the type
 
 		class exception
 		{
@@ -76,6 +840,8 @@ namespace nicehero
 		}
 		json_view(double t) : m_value(t), m_type(json_type::json_double) {
 		}
+		json_view(float t) : m_value(t), m_type(json_type::json_float) {
+		}
 		json_view(const std::string& t) : m_value(t), m_type(json_type::json_string) {
 		}
 		json_view(const copy_str_ref& t) : m_value(t), m_type(json_type::json_string) {
@@ -84,30 +850,45 @@ namespace nicehero
 		}
 		json_view(json_view&& rhs) noexcept : m_value() {
 			m_type = rhs.m_type;
-			if (m_type == json_type::json_object || m_type == json_type::json_array) {
+			if (m_type == json_type::json_object || m_type == json_type::json_array || m_type == json_type::json_raw) {
 				m_container = rhs.m_container;
 				// 				m_key = rhs.m_key;
 				m_keys = rhs.m_keys;
 				rhs.m_keys = nullptr;
 				rhs.m_container = nullptr;
 			}
+			else if (m_type == json_type::json_typed_array) {
+				m_typed = rhs.m_typed;
+				rhs.m_typed = nullptr;
+			}
 			else {
 				m_value = std::move(rhs.m_value);
+				m_flags = rhs.m_flags;
+				m_rawlen = rhs.m_rawlen;
+				m_rawhi = rhs.m_rawhi;
 			}
 			rhs.m_type = json_type::json_delete;
 		}
 		json_view(const json_view& rhs) : m_value() {
 			m_type = rhs.m_type;
 			if (m_type == json_type::json_object) {
-				m_container = new std::vector<kjson_view>();
+				m_container = new container_type();
 				m_keys = new keys_type();
 				m_container->resize(rhs.m_container->size());
+				m_container->m_source = rhs.m_container->m_source;
+				m_container->m_sourceLen = rhs.m_container->m_sourceLen;
+				m_container->m_keep = rhs.m_container->m_keep;
 				m_keys->reserve(rhs.m_keys->size());
 				for (size_t i = 0;i < rhs.m_container->size(); ++ i) {
 					kjson_view& kjv = rhs.m_container->at(i);
 					auto rkey = copy_str_ref(kjv.first);
 					auto& v = m_container->at(i);
- 					v.first.init(rkey);
+					if (kjv.first.is_escaped()) {
+						v.first = kjv.first;
+					}
+					else {
+						v.first.init(rkey);
+					}
 					v.second = kjv.second;
 					if (kjv.second.m_type != json_type::json_delete) {
 						m_keys->emplace(rkey, uint32_t(i));
@@ -116,9 +897,12 @@ namespace nicehero
 			}
 			else if (m_type == json_type::json_array)
 			{
-				m_container = new std::vector<kjson_view>();
+				m_container = new container_type();
 				m_keys = nullptr;
 				m_container->resize(rhs.m_container->size());
+				m_container->m_source = rhs.m_container->m_source;
+				m_container->m_sourceLen = rhs.m_container->m_sourceLen;
+				m_container->m_keep = rhs.m_container->m_keep;
 				for (size_t i = 0; i < rhs.m_container->size(); ++i) {
 					kjson_view& kjv = rhs.m_container->at(i);
 					auto rkey = copy_str_ref(kjv.first);
@@ -126,28 +910,49 @@ namespace nicehero
 					m_container->at(i).second = kjv.second;
 				}
 			}
+			else if (m_type == json_type::json_typed_array) {
+				m_typed = new typed_array(*rhs.m_typed);
+			}
+			else if (m_type == json_type::json_raw) {
+				m_container = new container_type();
+				m_keys = nullptr;
+				m_container->m_source = rhs.m_container->m_source;
+				m_container->m_sourceLen = rhs.m_container->m_sourceLen;
+				m_container->m_keep = rhs.m_container->m_keep;
+			}
 			else {
 				m_value = rhs.m_value;
+				m_flags = rhs.m_flags;
+				m_rawlen = rhs.m_rawlen;
+				m_rawhi = rhs.m_rawhi;
 			}
 		}
 		json_view& operator=(const json_view& rhs) noexcept {
 			if (this == &rhs) {
 				return *this;
 			}
-			if (m_type == json_type::json_object) {
+			if (m_type == json_type::json_object || m_type == json_type::json_typed_array || m_type == json_type::json_raw) {
 				this->~json_view();
 			}
 			m_type = rhs.m_type;
 			if (m_type == json_type::json_object) {
-				m_container = new std::vector<kjson_view>();
+				m_container = new container_type();
 				m_keys = new keys_type();
 				m_container->resize(rhs.m_container->size());
+				m_container->m_source = rhs.m_container->m_source;
+				m_container->m_sourceLen = rhs.m_container->m_sourceLen;
+				m_container->m_keep = rhs.m_container->m_keep;
 				m_keys->reserve(rhs.m_keys->size());
 				for (size_t i = 0; i < rhs.m_container->size(); ++i) {
 					kjson_view& kjv = rhs.m_container->at(i);
 					auto rkey = copy_str_ref(kjv.first);
 					auto& v = m_container->at(i);
-					v.first.init(rkey);
+					if (kjv.first.is_escaped()) {
+						v.first = kjv.first;
+					}
+					else {
+						v.first.init(rkey);
+					}
 					v.second = kjv.second;
 					if (kjv.second.m_type != json_type::json_delete) {
 						m_keys->emplace(rkey, uint32_t(i));
@@ -156,33 +961,59 @@ namespace nicehero
 			}
 			else if (m_type == json_type::json_array)
 			{
-				m_container = new std::vector<kjson_view>();
+				m_container = new container_type();
 				m_keys = nullptr;
 				m_container->resize(rhs.m_container->size());
+				m_container->m_source = rhs.m_container->m_source;
+				m_container->m_sourceLen = rhs.m_container->m_sourceLen;
+				m_container->m_keep = rhs.m_container->m_keep;
 				for (size_t i = 0; i < rhs.m_container->size(); ++i) {
 					kjson_view& kjv = rhs.m_container->at(i);
 					m_container->at(i).second = kjv.second;
 				}
 			}
+			else if (m_type == json_type::json_typed_array) {
+				m_typed = new typed_array(*rhs.m_typed);
+			}
+			else if (m_type == json_type::json_raw) {
+				m_container = new container_type();
+				m_keys = nullptr;
+				m_container->m_source = rhs.m_container->m_source;
+				m_container->m_sourceLen = rhs.m_container->m_sourceLen;
+				m_container->m_keep = rhs.m_container->m_keep;
+			}
 			else {
 				m_value = rhs.m_value;
+				m_flags = rhs.m_flags;
+				m_rawlen = rhs.m_rawlen;
+				m_rawhi = rhs.m_rawhi;
 			}
 			return *this;
 		}
 		json_view& operator=(json_view&& rhs) noexcept {
+			if (m_type == json_type::json_typed_array || m_type == json_type::json_raw) {
+				this->~json_view();
+			}
 			if (m_type != json_type::json_object && m_type != json_type::json_array) {
 				m_value.init("");
 			}
 			m_type = rhs.m_type;
-			if (m_type == json_type::json_object || m_type == json_type::json_array) {
+			if (m_type == json_type::json_object || m_type == json_type::json_array || m_type == json_type::json_raw) {
 				m_container = rhs.m_container;
 				// 				m_key = rhs.m_key;
 				m_keys = rhs.m_keys;
 				rhs.m_keys = nullptr;
 				rhs.m_container = nullptr;
 			}
+			else if (m_type == json_type::json_typed_array) {
+				m_typed = rhs.m_typed;
+				rhs.m_typed = nullptr;
+			}
 			else {
 				m_value = std::move(rhs.m_value);
+				m_flags = rhs.m_flags;
+				m_rawlen = rhs.m_rawlen;
+				m_rawhi = rhs.m_rawhi;
 			}
 			rhs.m_type = json_type::json_delete;
 			return *this;
@@ -203,6 +1034,11 @@ namespace nicehero
 			m_value.init(t);
 			return *this;
 		}
+		json_view& operator=(float t) noexcept {
+			init(json_type::json_float);
+			m_value.init(t);
+			return *this;
+		}
 		json_view& operator=(const std::string& t) noexcept {
 			init(json_type::json_string);
 			m_value.init(t);
@@ -228,7 +1064,7 @@ namespace nicehero
 			return *this;
 		}
 		~json_view() {
-			if (m_type == json_type::json_object || m_type == json_type::json_array) {
+			if (m_type == json_type::json_object || m_type == json_type::json_array || m_type == json_type::json_raw) {
 				if (m_container) {
 					m_container->clear();
 					delete m_container;
@@ -242,12 +1078,21 @@ namespace nicehero
 				m_value.get_type_ref() = value_type::string_view_value;
 				m_value.init("");
 			}
+			else if (m_type == json_type::json_typed_array) {
+				if (m_typed) {
+					delete m_typed;
+					m_typed = nullptr;
+				}
+				m_type = json_type::json_delete;
+				m_value.get_type_ref() = value_type::string_view_value;
+				m_value.init("");
+			}
 		}
 		void init(json_type t, semantic_tag tag_ = semantic_tag::none) {
-			if (t == json_type::json_lazy) {
+			if (t == json_type::json_lazy || t == json_type::json_raw) {
 				t = json_type::json_null;
 			}
-			if (m_type == json_type::json_object || m_type == json_type::json_array) {
+			if (m_type == json_type::json_object || m_type == json_type::json_array || m_type == json_type::json_raw) {
 				if (m_container) {
 					delete m_container;
 					m_container = nullptr;
@@ -257,7 +1102,15 @@ namespace nicehero
 					m_keys = nullptr;
 				}
 			}
+			else if (m_type == json_type::json_typed_array) {
+				if (m_typed) {
+					delete m_typed;
+					m_typed = nullptr;
+				}
+				m_value.get_type_ref() = value_type::string_view_value;
+			}
 			m_tag = tag_;
+			m_flags = 0;
 			m_value.init("");
 			m_type = t;
 			switch (t) {
@@ -278,13 +1131,13 @@ namespace nicehero
 				break;
 			}
 			case json_type::json_array: {
-				m_container = new std::vector<kjson_view>();
+				m_container = new container_type();
 				m_keys = nullptr;
 				break;
 			}
 			case json_type::json_object: {
 				m_keys = new keys_type();
-				m_container = new std::vector<kjson_view>();
+				m_container = new container_type();
 				break;
 			}
 			default:
@@ -366,6 +1219,9 @@ namespace nicehero
 			}
 		};
 		iterator begin() {
+			expand_raw();
+			expand_typed_array();
+			mark_dirty();
 			iterator it;
 			it.m_parent = this;
 			it.m_type = m_type;
@@ -382,6 +1238,8 @@ namespace nicehero
 			return it;
 		}
 		iterator end() {
+			expand_raw();
+			expand_typed_array();
 			iterator it;
 			it.m_parent = this;
 			it.m_type = m_type;
@@ -393,10 +1251,12 @@ namespace nicehero
 			}
 			return it;
 		}
+		//typed arrays are read in place, val() hands out their elements through m_elem
 		struct const_iterator {
 			json_type m_type = json_type::json_null;
 			size_t m_arrayIt = 0;
 			const json_view* m_parent = nullptr;
+			std::shared_ptr<json_view> m_elem;
 			inline bool operator == (const const_iterator& rhs) const {
 				if (m_type != rhs.m_type) {
 					return false;
@@ -407,7 +1267,7 @@ namespace nicehero
 				if (m_type == json_type::json_object) {
 					return m_arrayIt == rhs.m_arrayIt;
 				}
-				if (m_type == json_type::json_array) {
+				if (m_type == json_type::json_array || m_type == json_type::json_typed_array) {
 					return m_arrayIt == rhs.m_arrayIt;
 				}
 				return false;
@@ -422,7 +1282,7 @@ namespace nicehero
 				if (m_type == json_type::json_object) {
 					return m_arrayIt != rhs.m_arrayIt;
 				}
-				if (m_type == json_type::json_array) {
+				if (m_type == json_type::json_array || m_type == json_type::json_typed_array) {
 					return m_arrayIt != rhs.m_arrayIt;
 				}
 				return false;
@@ -435,7 +1295,7 @@ namespace nicehero
 						++m_arrayIt;
 					}
 				}
-				else if (m_type == json_type::json_array) {
+				else if (m_type == json_type::json_array || m_type == json_type::json_typed_array) {
 					++m_arrayIt;
 				}
 				return *this;
@@ -452,7 +1312,7 @@ namespace nicehero
 				if (m_type == json_type::json_object) {
 					return (m_parent->m_container->at(m_arrayIt)).first;
 				}
-				if (m_type == json_type::json_array) {
+				if (m_type == json_type::json_array || m_type == json_type::json_typed_array) {
 					return jvalue_type(m_arrayIt);
 				}
 				return jvalue_type();
@@ -464,10 +1324,31 @@ namespace nicehero
 				if (m_type == json_type::json_array) {
 					return m_parent->m_container->at(m_arrayIt).second;
 				}
+				if (m_type == json_type::json_typed_array) {
+					const typed_array* ta = m_parent->m_typed;
+					if (m_arrayIt >= ta->size()) {
+						throw exception("error iterator");
+					}
+					//a copy of the iterator may still hand out the previous element
+					if (!m_elem || m_elem.use_count() > 1) {
+						m_elem = std::make_shared<json_view>();
+					}
+					if (ta->m_elem_type == json_type::json_double) {
+						*m_elem = ta->m_doubles[m_arrayIt];
+					}
+					else if (ta->m_elem_type == json_type::json_float) {
+						*m_elem = ta->m_floats[m_arrayIt];
+					}
+					else {
+						*m_elem = ta->m_int64s[m_arrayIt];
+					}
+					return *m_elem;
+				}
 				throw exception("error iterator");
 			}
 		};
 		const_iterator begin() const {
+			expand_raw();
 			const_iterator it;
 			it.m_parent = this;
 			it.m_type = m_type;
@@ -484,6 +1365,7 @@ namespace nicehero
 			return it;
 		}
 		const_iterator end() const {
+			expand_raw();
 			const_iterator it;
 			it.m_parent = this;
 			it.m_type = m_type;
@@ -493,12 +1375,17 @@ namespace nicehero
 			else if (m_type == json_type::json_array) {
 				it.m_arrayIt = m_container->size();
 			}
+			else if (m_type == json_type::json_typed_array) {
+				it.m_arrayIt = m_typed->size();
+			}
 			return it;
 		}
 		iterator find(const jvalue_type& key) {
+			expand_raw();
 			if (m_type != json_type::json_object) {
 				return end();
 			}
+			mark_dirty();
 			auto it2 = m_keys->find(key);
 			if (it2 == m_keys->end()) {
 				return end();
@@ -515,6 +1402,7 @@ namespace nicehero
 			return it;
 		}
 		const_iterator find(const jvalue_type& key) const {
+			expand_raw();
 			if (m_type != json_type::json_object) {
 				return end();
 			}
@@ -534,114 +1422,375 @@ namespace nicehero
 			return it;
 		}
 
-		std::string dump(int format_ = 0) {
-			std::string vl;
-// 			vl.reserve(1024 * 1024);
-			_dump(vl,1,format_);
-			return vl;
-		}
-		void _dump(std::string& vl,size_t layer, int format_) const {
-			if (m_type == json_type::json_object) {
-				if (m_container->size() < 1) {
-					vl << "{}";
-					return;
-				}
-				vl << "{";
-				bool isFirst = true;
-				for (auto it : *this) {
-					if (format_ > 0) {
-						if (isFirst) {
-							isFirst = false;
-						}
-						else {
-							vl << ",";
-						}
-						vl << "\n";
-						for (size_t i = 0; i < layer; ++i) {
-							vl << "\t";
-						}
-						vl << "\"";
+		//fixedPrecision 1..9 dumps every double with that many decimals
+		std::string dump(int format_ = 0, int fixedPrecision = 0) {
+			return _dumpToString(dump_style(format_, fixedPrecision));
+		}
+		std::string dump(const pretty_options& options, int fixedPrecision = 0) {
+			return _dumpToString(dump_style(options, fixedPrecision));
+		}
+		//one pass into a growing buffer, sizing it first with dump_size would format everything twice
+		std::string _dumpToString(const dump_style& st) const {
+			output_buffer vl;
+			_dump(vl, 1, st);
+			return vl.str();
+		}
+		//writes dump(format_, fixedPrecision) to sink through a fixed buffer, false if the sink failed
+		bool dump_to(const sink_type& sink, int format_ = 0, int fixedPrecision = 0, size_t bufferSize = sink_buffer::default_size) const {
+			return _dumpTo(sink, dump_style(format_, fixedPrecision), bufferSize);
+		}
+		bool dump_to(const sink_type& sink, const pretty_options& options, int fixedPrecision = 0, size_t bufferSize = sink_buffer::default_size) const {
+			return _dumpTo(sink, dump_style(options, fixedPrecision), bufferSize);
+		}
+		bool dump_to(std::ostream& os, int format_ = 0, int fixedPrecision = 0) const {
+			return dump_to(ostream_sink(os), format_, fixedPrecision);
+		}
+		bool dump_to(std::ostream& os, const pretty_options& options, int fixedPrecision = 0) const {
+			return dump_to(ostream_sink(os), options, fixedPrecision);
+		}
+		bool _dumpTo(const sink_type& sink, const dump_style& st, size_t bufferSize) const {
+			sink_buffer w(sink, bufferSize);
+			_dump(w, 1, st);
+			return w.flush();
+		}
+		//dump(format_, fixedPrecision) with the top-level object or array cut into chunks that
+		//threads (0: one per core) serialize at once, small documents are dumped sequentially
+		std::string dump_parallel(size_t threads = 0, int format_ = 0, int fixedPrecision = 0) const {
+			std::string r;
+			_dumpParallel([&r](const char* s, size_t n) {
+				r.append(s, n);
+				return true;
+			}, dump_style(format_, fixedPrecision), threads);
+			return r;
+		}
+		std::string dump_parallel(size_t threads, const pretty_options& options, int fixedPrecision = 0) const {
+			std::string r;
+			_dumpParallel([&r](const char* s, size_t n) {
+				r.append(s, n);
+				return true;
+			}, dump_style(options, fixedPrecision), threads);
+			return r;
+		}
+		//chunks reach the sink in document order as they complete, false if the sink failed
+		bool dump_parallel_to(const sink_type& sink, size_t threads = 0, int format_ = 0, int fixedPrecision = 0) const {
+			return _dumpParallel(sink, dump_style(format_, fixedPrecision), threads);
+		}
+		bool dump_parallel_to(const sink_type& sink, size_t threads, const pretty_options& options, int fixedPrecision = 0) const {
+			return _dumpParallel(sink, dump_style(options, fixedPrecision), threads);
+		}
+		//top-level containers with fewer elements are not worth the threads
+		static constexpr size_t parallel_dump_min_elements = 1024;
+		bool _dumpParallel(const sink_type& sink, const dump_style& st, size_t threads) const {
+			if (threads == 0) {
+				threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+			}
+			size_t s = _containerSize();
+			if (threads < 2 || s < parallel_dump_min_elements || (!st.m_pretty && st.m_fixedPrecision == 0 && !is_dirty())) {
+				return _dumpTo(sink, st, sink_buffer::default_size);
+			}
+			bool isObject = m_type == json_type::json_object;
+			bool pretty = _isPrettyContainer(st);
+			//several chunks per thread even out uneven elements, at most window of them wait for the sink
+			size_t chunkCount = std::min(s, threads * 8);
+			size_t window = threads * 2;
+			std::vector<output_buffer> chunks(chunkCount);
+			std::vector<uint8_t> done(chunkCount, 0);
+			std::atomic<size_t> next(0);
+			std::atomic<bool> stop(false);
+			size_t written = 0;
+			//the first exception of a worker, rethrown here once all of them have stopped
+			std::exception_ptr error;
+			std::mutex m;
+			std::condition_variable cv;
+			auto work = [&]() {
+				while (true) {
+					size_t i = next++;
+					if (i >= chunkCount) {
+						return;
 					}
-					else {
-						if (isFirst) {
-							isFirst = false;
-							vl << "\"";
+					{
+						std::unique_lock<std::mutex> l(m);
+						cv.wait(l, [&]() { return i < written + window || stop; });
+					}
+					if (!stop) {
+						try {
+							//every element gets its ',', the one opening the document is dropped below
+							_dumpRange(chunks[i], 1, st, pretty, s * i / chunkCount, s * (i + 1) / chunkCount, false);
 						}
-						else {
-							vl << ",\"";
+						catch (...) {
+							std::lock_guard<std::mutex> l(m);
+							if (!error) {
+								error = std::current_exception();
+							}
+							stop = true;
 						}
 					}
-					vl << it.key();
-					vl << "\":";
-					const auto& v = it.val();
-					if (v.m_type == json_type::json_string) {
-						vl << "\"" << v.m_value << "\"";
-					}
-					else if (v.m_type == json_type::json_object || v.m_type == json_type::json_array) {
-						v._dump(vl, layer + 1,format_);
-					}
-					else if (v.m_type == json_type::json_null)
 					{
-						vl << "null";
-					}
-					else {
-						vl << v.m_value;
+						std::lock_guard<std::mutex> l(m);
+						done[i] = 1;
 					}
+					cv.notify_all();
 				}
-				if (format_ > 0) {
-					vl << "\n";
-					for (size_t i = 0; i < layer - 1; ++i) {
-						vl << "\t";
-					}
+			};
+			std::vector<std::thread> pool;
+			auto finish = [&]() {
+				{
+					std::lock_guard<std::mutex> l(m);
+					stop = true;
 				}
-				vl << "}";
-			}
-			else if (m_type == json_type::json_array) {
-				if (m_container->size() < 1) {
-					vl << "[]";
-					return;
+				cv.notify_all();
+				for (auto& t : pool) {
+					t.join();
 				}
-				vl << "[";
-				bool isFirst = true;
-				for (auto it : *this) {
-					if (isFirst) {
-						isFirst = false;
-					}
-					else {
-						vl << ",";
+			};
+			sink_buffer w(sink);
+			try {
+				for (size_t t = 0; t < threads && t < chunkCount; ++t) {
+					pool.emplace_back(work);
+				}
+				w.push_back(isObject ? '{' : '[');
+				bool isFirst = true;
+				for (size_t i = 0; i < chunkCount; ++i) {
+					{
+						std::unique_lock<std::mutex> l(m);
+						cv.wait(l, [&]() { return done[i] != 0; });
 					}
-					if (format_ > 0) {
-						vl << "\n";
-						for (size_t i = 0; i < layer; ++i) {
-							vl << "\t";
+					if (w.good() && !stop) {
+						const char* p = chunks[i].data();
+						size_t n = chunks[i].size();
+						if (isFirst && n > 0) {
+							++p;
+							--n;
+							isFirst = false;
 						}
+						w.append(p, n);
 					}
-					const auto& v = it.val();
-					if (v.m_type == json_type::json_string) {
-						vl << "\"" << v.m_value << "\"";
-					}
-					else if (v.m_type == json_type::json_object || v.m_type == json_type::json_array) {
-						v._dump(vl, layer + 1, format_);
-					}
-					else if (v.m_type == json_type::json_null)
+					//frees the chunk
+					chunks[i].str();
 					{
-						vl << "null";
-					}
-					else {
-						vl << v.m_value;
+						std::lock_guard<std::mutex> l(m);
+						written = i + 1;
+						if (!w.good()) {
+							stop = true;
+						}
 					}
+					cv.notify_all();
+				}
+			}
+			catch (...) {
+				finish();
+				throw;
+			}
+			finish();
+			if (error) {
+				std::rethrow_exception(error);
+			}
+			if (pretty) {
+				st.new_line(w, 0);
+			}
+			w.push_back(isObject ? '}' : ']');
+			return w.flush();
+		}
+		//dump(format_, fixedPrecision) into buf without allocating, false if it does not fit in cap
+		//written is the length of the output, on overflow the capacity it needs
+		bool dump_into(char* buf, size_t cap, size_t& written, int format_ = 0, int fixedPrecision = 0) const {
+			return _dumpInto(buf, cap, written, dump_style(format_, fixedPrecision));
+		}
+		bool dump_into(char* buf, size_t cap, size_t& written, const pretty_options& options, int fixedPrecision = 0) const {
+			return _dumpInto(buf, cap, written, dump_style(options, fixedPrecision));
+		}
+		bool _dumpInto(char* buf, size_t cap, size_t& written, const dump_style& st) const {
+			bounded_writer w(buf, cap);
+			_dump(w, 1, st);
+			written = w.size();
+			return !w.overflow();
+		}
+		//exact length of dump(format_, fixedPrecision)
+		size_t dump_size(int format_ = 0, int fixedPrecision = 0) const {
+			size_counter c;
+			_dump(c, 1, dump_style(format_, fixedPrecision));
+			return c.size();
+		}
+		size_t dump_size(const pretty_options& options, int fixedPrecision = 0) const {
+			size_counter c;
+			_dump(c, 1, dump_style(options, fixedPrecision));
+			return c.size();
+		}
+		template <class Writer>
+		void _dump(Writer& vl, size_t layer, const dump_style& st) const {
+			if (m_type == json_type::json_raw) {
+				vl.append(m_container->m_source, m_container->m_sourceLen);
+				return;
+			}
+			if (!st.m_pretty && st.m_fixedPrecision == 0 && !is_dirty()) {
+				vl.append(m_container->m_source, m_container->m_sourceLen);
+				return;
+			}
+			bool isObject = m_type == json_type::json_object;
+			size_t s = _containerSize();
+			if (s < 1) {
+				if (isObject) {
+					vl << "{}";
+				}
+				else if (m_type == json_type::json_array || m_type == json_type::json_typed_array) {
+					vl << "[]";
 				}
-				if (format_ > 0) {
-					vl << "\n";
-					for (size_t i = 0; i < layer - 1; ++i) {
-						vl << "\t";
+				return;
+			}
+			bool pretty = _isPrettyContainer(st);
+			//punctuation and indent of every element in one go
+			size_t perElement = isObject ? 4 : (m_type == json_type::json_typed_array ? 10 : 1);
+			vl.reserve(s * (pretty ? st.line_size(layer) + perElement : perElement) + st.line_size(layer) + 1);
+			vl.push_back(isObject ? '{' : '[');
+			_dumpRange(vl, layer, st, pretty, 0, s, true);
+			if (pretty) {
+				st.new_line(vl, layer - 1);
+			}
+			vl.push_back(isObject ? '}' : ']');
+		}
+		//members or elements of an object, array or typed array
+		inline size_t _containerSize() const {
+			if (m_type == json_type::json_object || m_type == json_type::json_array) {
+				return m_container->size();
+			}
+			if (m_type == json_type::json_typed_array) {
+				return m_typed->size();
+			}
+			return 0;
+		}
+		//whether the elements go on lines of their own
+		inline bool _isPrettyContainer(const dump_style& st) const {
+			if (!st.m_pretty || !st.m_compactScalarArrays || m_type == json_type::json_object) {
+				return st.m_pretty;
+			}
+			return m_type != json_type::json_typed_array && !_isScalarArray();
+		}
+		//elements [begin, end) with their separators, the first written one has no ',' if isFirst
+		template <class Writer>
+		void _dumpRange(Writer& vl, size_t layer, const dump_style& st, bool pretty, size_t begin, size_t end, bool isFirst) const {
+			if (m_type == json_type::json_typed_array) {
+				for (size_t i = begin; i < end && writer_good(vl); ++i) {
+					if (!isFirst) {
+						vl << ",";
 					}
+					isFirst = false;
+					if (pretty) {
+						st.new_line(vl, layer);
+					}
+					_dumpTypedElement(vl, st, i);
+				}
+				return;
+			}
+			bool isObject = m_type == json_type::json_object;
+			for (size_t i = begin; i < end && writer_good(vl); ++i) {
+				const auto& kv = (*m_container)[i];
+				const auto& v = kv.second;
+				if (isObject && v.m_type == json_type::json_delete) {
+					continue;
+				}
+				if (!isFirst) {
+					vl << ",";
+				}
+				isFirst = false;
+				if (pretty) {
+					st.new_line(vl, layer);
+				}
+				if (isObject) {
+					vl << "\"";
+					_dumpString(vl, kv.first);
+					vl << "\":";
+				}
+				v._dumpValue(vl, layer, st);
+			}
+		}
+		//no objects or arrays among the elements
+		bool _isScalarArray() const {
+			for (const auto& kv : *m_container) {
+				json_type t = kv.second.m_type;
+				if (t == json_type::json_object || t == json_type::json_array || t == json_type::json_typed_array || t == json_type::json_raw) {
+					return false;
+				}
+			}
+			return true;
+		}
+		//a member or element value, layer is the depth of its container
+		template <class Writer>
+		void _dumpValue(Writer& vl, size_t layer, const dump_style& st) const {
+			if (st.m_fixedPrecision > 0 && m_type == json_type::json_lazy) {
+				//a lazy number has to be resolved to know if it is a double
+				check_type();
+			}
+			if (m_type == json_type::json_string) {
+				vl << "\"";
+				_dumpString(vl, m_value);
+				vl << "\"";
+			}
+			else if (m_type == json_type::json_object || m_type == json_type::json_array || m_type == json_type::json_typed_array
+				|| m_type == json_type::json_raw) {
+				_dump(vl, layer + 1, st);
+			}
+			else if (m_type == json_type::json_null)
+			{
+				vl << "null";
+			}
+#if defined(NICEHERO_HAS_INT128)
+			else if (m_type == json_type::json_int128) {
+				from_int128(as_int128(), vl);
+			}
+#endif
+			else if (fixed_precision() > 0) {
+				dtoa_fixed_precision(as_number(), fixed_precision(), vl);
+			}
+			else if (st.m_fixedPrecision > 0 && is_double()) {
+				dtoa_fixed_precision(as_number(), st.m_fixedPrecision, vl);
+			}
+			else if (has_raw_number()) {
+				vl << raw_number();
+			}
+			else {
+				vl << m_value;
+			}
+		}
+		//parsed double-quoted text is copied as is, anything else is escaped
+		template <class Writer>
+		static void _dumpString(Writer& vl, const jvalue_type& s) {
+			if (s.is_escaped()) {
+				vl << s;
+				return;
+			}
+			size_t len = 0;
+			const char* p = s.string_data(len);
+			if (!p) {
+				vl << s;
+				return;
+			}
+			write_json_escaped(p, len, vl);
+		}
+		template <class Writer>
+		void _dumpTypedElement(Writer& vl, const dump_style& st, size_t i) const {
+			if (m_typed->m_elem_type == json_type::json_double) {
+				if (st.m_fixedPrecision > 0) {
+					dtoa_fixed_precision(m_typed->m_doubles[i], st.m_fixedPrecision, vl);
+				}
+				else {
+					static write_double f(float_chars_format::general, 0);
+					f(m_typed->m_doubles[i], vl);
+				}
+			}
+			else if (m_typed->m_elem_type == json_type::json_float) {
+				if (st.m_fixedPrecision > 0) {
+					dtoa_fixed_precision(m_typed->m_floats[i], st.m_fixedPrecision, vl);
+				}
+				else {
+					ftoa_shortest(m_typed->m_floats[i], vl);
 				}
-				vl << "]";
+			}
+			else {
+				from_integer(m_typed->m_int64s[i], vl);
 			}
 		}
 
-		bool parse(const char* jdata,bool isLazy = true) {
+		bool parse(const char* jdata,bool isLazy = true, uint32_t flags = parse_none) {
 			jdata = lstrip(jdata);
 			if (!jdata) {
 				return false;
@@ -649,15 +1798,16 @@ namespace nicehero
 			m_value = jdata;
 			if (*jdata == '{') {
 				init(json_type::json_object);
-				return _parseObject(jdata, isLazy);
+				return _parseObject(jdata, isLazy, flags);
 			}
 			if (*jdata == '[') {
 				init(json_type::json_array);
-				return _parseArray(jdata, isLazy);
+				return _parseArray(jdata, isLazy, flags);
 			}
 			return false;
 		}
-		const char* _parseObject(const char* jdata,bool isLazy) {
+		const char* _parseObject(const char* jdata,bool isLazy, uint32_t flags = parse_none) {
+			const char* source = jdata;
 			++jdata;
 			jdata = lstrip(jdata);
 			if (!jdata) {
@@ -673,10 +1823,12 @@ namespace nicehero
 					return nullptr;
 				}
 				jdata = vl.m_start + vl.m_len;
+				bool keyEscaped = false;
 				if (_cInQuotas(vl.m_start[0],"\"\'") && _cInQuotas(vl.m_start[vl.m_len - 1], "\"\'")) {
 					if (vl.m_len < 3) {
 						return nullptr;
 					}
+					keyEscaped = vl.m_start[0] == '"';
 					vl.m_start += 1;
 					vl.m_len -= 2;
 				}
@@ -686,19 +1838,20 @@ namespace nicehero
 				}
 				m_container->emplace_back();
 				m_container->back().first.init(vl.m_start, vl.m_len);
+				m_container->back().first.set_escaped(keyEscaped);
 				json_view& newJV = m_container->back().second;
 				++jdata;
 				jdata = lstrip(jdata);
 				if (*jdata == '{') {
 					newJV.init(json_type::json_object);
-					jdata = newJV._parseObject(jdata,isLazy);
+					jdata = newJV._parseObject(jdata,isLazy, flags);
 					if (!jdata) {
 						return nullptr;
 					}
 				}
 				else if (*jdata == '[') {
 					newJV.init(json_type::json_array);
-					jdata = newJV._parseArray(jdata, isLazy);
+					jdata = newJV._parseArray(jdata, isLazy, flags);
 					if (!jdata) {
 						return nullptr;
 					}
@@ -710,6 +1863,15 @@ namespace nicehero
 						return nullptr;
 					}
 					newJV.m_type = json_type::json_lazy;
+					if (flags & parse_raw_number) {
+						newJV.m_flags |= flag_raw_number;
+					}
+					if (flags & parse_bigdec) {
+						newJV.m_flags |= flag_bigdec;
+					}
+					if (flags & parse_float32) {
+						newJV.m_flags |= flag_float32;
+					}
 					jdata = vl2.m_start + vl2.m_len;
 					if (!isLazy) {
 						newJV.check_type();
@@ -732,6 +1894,10 @@ namespace nicehero
 					if (!jdata) {
 						return nullptr;
 					}
+					if (flags & parse_keep_source) {
+						m_container->m_source = source;
+						m_container->m_sourceLen = size_t(jdata - source);
+					}
 					jdata = lstrip(jdata);
 					break;
 				}
@@ -757,7 +1923,14 @@ namespace nicehero
 #endif
 			return jdata;
 		}
-		const char* _parseArray(const char* jdata,bool isLazy) {
+		const char* _parseArray(const char* jdata,bool isLazy, uint32_t flags = parse_none) {
+			if (flags & parse_typed_array) {
+				const char* typedEnd = _parseTypedArray(jdata, flags);
+				if (typedEnd) {
+					return typedEnd;
+				}
+			}
+			const char* source = jdata;
 			++jdata;
 			while (true) {
 				jdata = lstrip(jdata);
@@ -773,14 +1946,14 @@ namespace nicehero
 				jdata = lstrip(jdata);
 				if (*jdata == '{') {
 					newJV.init(json_type::json_object);
-					jdata = newJV._parseObject(jdata, isLazy);
+					jdata = newJV._parseObject(jdata, isLazy, flags);
 					if (!jdata) {
 						return nullptr;
 					}
 				}
 				else if (*jdata == '[') {
 					newJV.init(json_type::json_array);
-					jdata = newJV._parseArray(jdata, isLazy);
+					jdata = newJV._parseArray(jdata, isLazy, flags);
 					if (!jdata) {
 						return nullptr;
 					}
@@ -792,6 +1965,15 @@ namespace nicehero
 						return nullptr;
 					}
 					newJV.m_type = json_type::json_lazy;
+					if (flags & parse_raw_number) {
+						newJV.m_flags |= flag_raw_number;
+					}
+					if (flags & parse_bigdec) {
+						newJV.m_flags |= flag_bigdec;
+					}
+					if (flags & parse_float32) {
+						newJV.m_flags |= flag_float32;
+					}
 					jdata = vl2.m_start + vl2.m_len;
 					if (!isLazy) {
 						newJV.check_type();
@@ -804,12 +1986,112 @@ namespace nicehero
 				}
 				if (*jdata == ']') {
 					++jdata;
+					if (flags & parse_keep_source) {
+						m_container->m_source = source;
+						m_container->m_sourceLen = size_t(jdata - source);
+					}
 					break;
 				}
 				// 					*m_keys.emplace({ jdata,n }, m_container->size());
 			}
 			return jdata;
 		}
+		//parse an array of only integers or only doubles into typed_array, return nullptr if it is not such an array
+		//mixed arrays stay ordinary elements so integers keep their type and precision
+		const char* _parseTypedArray(const char* jdata, uint32_t flags = parse_none) {
+			typed_array ta;
+			++jdata;
+			while (true) {
+				jdata = lstrip(jdata);
+				bool isDouble = false;
+				const char* numEnd = _scanNumber(jdata, isDouble);
+				if (!numEnd) {
+					return nullptr;
+				}
+				if (ta.size() > 0 && isDouble != (ta.m_elem_type != json_type::json_int64)) {
+					return nullptr;
+				}
+				if ((flags & parse_float32) && isDouble) {
+					ta.to_float();
+					float t;
+					if (!to_float(jdata, numEnd - jdata, t)) {
+						return nullptr;
+					}
+					ta.m_floats.push_back(t);
+				}
+				else if (isDouble) {
+					ta.to_double();
+					double t;
+					if (!strtod_c(jdata, numEnd - jdata, t)) {
+						return nullptr;
+					}
+					ta.m_doubles.push_back(t);
+				}
+				else {
+					int64_t t;
+					auto result = to_integer_unchecked(jdata, numEnd - jdata, t);
+					if (!result) {
+						return nullptr;
+					}
+					ta.m_int64s.push_back(t);
+				}
+				jdata = lstrip(numEnd);
+				if (*jdata == ',') {
+					++jdata;
+					continue;
+				}
+				if (*jdata == ']') {
+					++jdata;
+					break;
+				}
+				return nullptr;
+			}
+			init(json_type::json_null);
+			m_typed = new typed_array(std::move(ta));
+			m_type = json_type::json_typed_array;
+			return jdata;
+		}
+		//return the end of a json number or nullptr
+		static const char* _scanNumber(const char* jdata, bool& isDouble) {
+			if (*jdata == '-') {
+				++jdata;
+			}
+			if (*jdata == '0') {
+				++jdata;
+			}
+			else if (*jdata >= '1' && *jdata <= '9') {
+				while (*jdata >= '0' && *jdata <= '9') {
+					++jdata;
+				}
+			}
+			else {
+				return nullptr;
+			}
+			if (*jdata == '.') {
+				isDouble = true;
+				++jdata;
+				if (*jdata < '0' || *jdata > '9') {
+					return nullptr;
+				}
+				while (*jdata >= '0' && *jdata <= '9') {
+					++jdata;
+				}
+			}
+			if (*jdata == 'e' || *jdata == 'E') {
+				isDouble = true;
+				++jdata;
+				if (*jdata == '+' || *jdata == '-') {
+					++jdata;
+				}
+				if (*jdata < '0' || *jdata > '9') {
+					return nullptr;
+				}
+				while (*jdata >= '0' && *jdata <= '9') {
+					++jdata;
+				}
+			}
+			return jdata;
+		}
 		static inline bool _cInQuotas(char c, const char* otherQuotas){
 			for (size_t i = 0;; ++i) {
 				if (otherQuotas[i] == '\0') {
@@ -840,10 +2122,13 @@ namespace nicehero
 					++r;
 					if (jdata[r] == '\''
 						|| jdata[r] == '\"' 
+						|| jdata[r] == '\\'
+						|| jdata[r] == '/'
 						|| jdata[r] == 'r'
 						|| jdata[r] == 'n'
 						|| jdata[r] == 't'
-						|| jdata[r] == 'b') {
+						|| jdata[r] == 'b'
+						|| jdata[r] == 'f') {
 						++r;
 						continue;
 					}
@@ -865,7 +2150,7 @@ namespace nicehero
 							else if (jdata[r] < 'a') {
 								return jvalue_type();
 							}
-							else if (jdata[r] < 'f') {
+							else if (jdata[r] <= 'f') {
 								continue;
 							}
 							return jvalue_type();
@@ -911,9 +2196,11 @@ namespace nicehero
 		}
 
 		json_view& operator[](const jvalue_type& key) {
+			expand_raw();
 			if (m_type == json_type::json_null || m_type == json_type::json_delete) {
 				init(json_type::json_object);
 			}
+			mark_dirty();
 			if (m_type == json_type::json_object) {
 				auto it = m_keys->find(key);
 				if (it == m_keys->end()) {
@@ -929,6 +2216,9 @@ namespace nicehero
 		}
 
 		json_view& operator[](int index_) {
+			expand_raw();
+			expand_typed_array();
+			mark_dirty();
 			if (m_type != json_type::json_array || !m_container || index_ >= m_container->size())
 			{
 				throw exception("error index");
@@ -937,9 +2227,11 @@ namespace nicehero
 		}
 
 		json_view& add_member(const jvalue_type& key) {
+			expand_raw();
 			if (m_type == json_type::json_null || m_type == json_type::json_delete) {
 				init(json_type::json_object);
 			}
+			mark_dirty();
 			if (m_type == json_type::json_object) {
 				auto it = m_keys->find(key);
 				if (it == m_keys->end()) {
@@ -955,9 +2247,12 @@ namespace nicehero
 		}
 
 		void push_back(const json_view& jv) {
+			expand_raw();
 			if (m_type == json_type::json_null || m_type == json_type::json_delete) {
 				init(json_type::json_array);
 			}
+			expand_typed_array();
+			mark_dirty();
 			if (m_type == json_type::json_array) {
 				m_container->emplace_back();
 				m_container->back().second = jv;
@@ -965,12 +2260,27 @@ namespace nicehero
 		}
 
 		void pop_back() {
+			expand_raw();
+			mark_dirty();
 			if (m_type == json_type::json_array) {
 				m_container->pop_back();
 			}
+			else if (m_type == json_type::json_typed_array) {
+				if (m_typed->m_elem_type == json_type::json_double) {
+					m_typed->m_doubles.pop_back();
+				}
+				else if (m_typed->m_elem_type == json_type::json_float) {
+					m_typed->m_floats.pop_back();
+				}
+				else {
+					m_typed->m_int64s.pop_back();
+				}
+			}
 		}
 
 		void erase(const viewvalue& key) {
+			expand_raw();
+			mark_dirty();
 			if (m_type == json_type::json_object) {
 				auto it = m_keys->find(key);
 				if (it != m_keys->end()) {
@@ -980,27 +2290,53 @@ namespace nicehero
 			}
 		}
 
+		//false while an object or array parsed with parse_keep_source is unchanged.
+		//non-const access to members or elements counts as a change
+		inline bool is_dirty() const {
+			if (m_type != json_type::json_object && m_type != json_type::json_array) {
+				return true;
+			}
+			return !m_container || !m_container->m_source;
+		}
+		//drops the source text, dump serializes the container again
+		inline void mark_dirty() {
+			if ((m_type == json_type::json_object || m_type == json_type::json_array) && m_container) {
+				m_container->m_source = nullptr;
+				m_container->m_sourceLen = 0;
+			}
+		}
+
 		size_t size() {
+			expand_raw();
 			if (m_type == json_type::json_object) {
 				return m_keys->size();
 			}
 			if (m_type == json_type::json_array) {
 				return m_container->size();
 			}
+			if (m_type == json_type::json_typed_array) {
+				return m_typed->size();
+			}
+			return 0;
 		}
 
 		bool check_type() const {
+			if (m_type == json_type::json_raw) {
+				return expand_raw();
+			}
 			if (m_type == json_type::json_lazy) {
 				if (m_value.get_type() != value_type::string_view_value) {
 					return false;
 				}
 				if (_cInQuotas(m_value.front(), "\"\'")) {
 					if (m_value.back() == m_value.front() && m_value.m_len > 1) {
+						bool escaped = m_value.front() == '"';
 						m_value.m_start += 1;
 						m_value.m_len -= 2;
 						if (m_value.m_len < 1) {
 							m_value.m_start = "";
 						}
+						m_value.set_escaped(escaped);
 						m_type = json_type::json_string;
 						return true;
 					}
@@ -1025,6 +2361,15 @@ namespace nicehero
 					m_type = json_type::json_boolean;
 					return true;
 				}
+				if (m_value.front() == 'n' && m_value.m_len == 4
+					&& m_value.m_start[1] == 'u'
+					&& m_value.m_start[2] == 'l'
+					&& m_value.m_start[3] == 'l'
+					) {
+					m_value.init("");
+					m_type = json_type::json_null;
+					return true;
+				}
 				json_type preType = json_type::json_uint64;
 				jvalue_type vl = m_value;
 				if (vl.m_len < 1) {
@@ -1055,13 +2400,15 @@ namespace nicehero
 						return false;
 					}
 				}
+				const char* rawStart = m_value.m_start;
+				uint32_t rawLen = m_value.m_len;
 				switch (preType)
 				{
 				case nicehero::json_type::json_int64: {
 					int64_t t;
 					auto result = to_integer_unchecked(m_value.m_start, m_value.m_len, t);
 					if (!result) {
-						return false;
+						return _checkBigInteger();
 					}
 					m_value.init(t);
 					break;
@@ -1070,16 +2417,28 @@ namespace nicehero
 					uint64_t t;
 					auto result = to_integer_unchecked(m_value.m_start, m_value.m_len, t);
 					if (!result) {
-						return false;
+						return _checkBigInteger();
 					}
 					m_value.init(t);
 					break;
 				}
 				case nicehero::json_type::json_double: {
-					static to_double_t td;
+					if ((m_flags & flag_bigdec) && _significantDigits(m_value.m_start, m_value.m_len) > 17) {
+						m_type = json_type::json_bignum;
+						m_tag = semantic_tag::bigdec;
+						return true;
+					}
+					if (m_flags & flag_float32) {
+						float t;
+						if (!to_float(m_value.m_start, m_value.m_len, t)) {
+							return false;
+						}
+						m_value.init(t);
+						preType = json_type::json_float;
+						break;
+					}
 					double t;
-					t = td(m_value.m_start, m_value.m_len);
-					if (!td.isok) {
+					if (!strtod_c(m_value.m_start, m_value.m_len, t)) {
 						return false;
 					}
 					m_value.init(t);
@@ -1090,9 +2449,80 @@ namespace nicehero
 					break;
 				}
 				m_type = preType;
+				if (m_flags & flag_raw_number) {
+					set_raw_number(rawStart, rawLen);
+				}
 			}
 			return true;
 		}
+		//integer that overflows 64 bits, kept as int128 or as bigint text
+		bool _checkBigInteger() const {
+#if defined(NICEHERO_HAS_INT128)
+			int128_t t;
+			auto result = to_int128_unchecked(m_value.m_start, m_value.m_len, t);
+			if (result) {
+				_storeInt128(t);
+				return true;
+			}
+#endif
+			m_type = json_type::json_bignum;
+			m_tag = semantic_tag::bigint;
+			return true;
+		}
+		static size_t _significantDigits(const char* s, uint32_t len) {
+			size_t digits = 0;
+			for (uint32_t i = 0; i < len; ++i) {
+				if (s[i] == 'e' || s[i] == 'E') {
+					break;
+				}
+				if (s[i] < '0' || s[i] > '9' || (digits == 0 && s[i] == '0')) {
+					continue;
+				}
+				++digits;
+			}
+			return digits;
+		}
+#if defined(NICEHERO_HAS_INT128)
+		//low 64 bits in m_value, high 64 bits split over m_value.m_len and m_rawhi
+		void _storeInt128(int128_t v) const {
+			uint128_t u = uint128_t(v);
+			uint64_t hi = uint64_t(u >> 64);
+			m_value.init(uint64_t(u));
+			m_value.m_len = uint32_t(hi);
+			m_rawhi = uint32_t(hi >> 32);
+			m_type = json_type::json_int128;
+		}
+		json_view& operator=(int128_t t) noexcept {
+			init(json_type::json_int128);
+			_storeInt128(t);
+			return *this;
+		}
+#endif
+		//number parsed with parse_raw_number and not changed since
+		inline bool has_raw_number() const {
+			return (m_flags & flag_raw_number) && (m_type == json_type::json_int64
+				|| m_type == json_type::json_uint64 || m_type == json_type::json_double || m_type == json_type::json_float);
+		}
+		//source text of the number, empty if has_raw_number() is false
+		inline jvalue_type raw_number() const {
+			if (!has_raw_number()) {
+				return jvalue_type();
+			}
+			uint64_t p = (uint64_t(m_rawhi) << 32) | m_value.m_len;
+			return jvalue_type((const char*)uintptr_t(p), m_rawlen);
+		}
+		//the number keeps its 8 bytes in m_value, the pointer is split over m_value.m_len and m_rawhi
+		void set_raw_number(const char* s, uint32_t len) const {
+			if (len < 1 || len > 0xFF) {
+				m_flags &= ~flag_raw_number;
+				return;
+			}
+			uint64_t p = uint64_t(uintptr_t(s));
+			m_value.m_len = uint32_t(p);
+			m_rawhi = uint32_t(p >> 32);
+			m_rawlen = uint8_t(len);
+			m_flags |= flag_raw_number;
+		}
 		static inline bool little_endianness(int num = 1) noexcept {
 			return *reinterpret_cast<char*>(&num) == 1;
 		}
@@ -1145,6 +2575,53 @@ namespace nicehero
 				++bson_data;
 			}
 		}
+		//dump_bson writes the value back as type t, prefix is the bytes of the value in front of m_value
+		inline void _keepBsonType(uint8_t t, uint32_t prefix = 0) {
+			m_flags |= flag_bson_verbatim;
+			m_rawlen = t;
+			m_rawhi = prefix;
+		}
+		//encoded bytes of a flag_bson_verbatim value, they still lie in the parsed buffer around m_value
+		inline void _bsonVerbatim(const char*& p, size_t& n) const {
+			const char* s = m_value.m_start;
+			switch (m_rawlen) {
+			case 0x05: // int32 length in front of subtype and data
+				p = s - sizeof(int32_t);
+				n = sizeof(int32_t) + m_value.m_len;
+				return;
+			case 0x0C: // namespace string in front of the ObjectId
+				p = s - m_rawhi;
+				n = m_rawhi + 12;
+				return;
+			case 0x0D:
+			case 0x0E: // int32 length in front, NUL after
+				p = s - sizeof(int32_t);
+				n = sizeof(int32_t) + m_value.m_len + 1;
+				return;
+			case 0x0F: // int32 total and int32 code length in front, scope after
+			{
+				p = s - 2 * sizeof(int32_t);
+				viewvalue total(p, sizeof(int32_t));
+				int32_t t{};
+				get_bson_number<int32_t>(t, total);
+				n = size_t(t);
+				return;
+			}
+			case 0x0B: // NUL after the options
+				p = s;
+				n = m_value.m_len + 1;
+				return;
+			case 0x07:
+			case 0x13:
+				p = s;
+				n = m_value.m_len;
+				return;
+			default: // undefined, min key and max key have no bytes
+				p = s;
+				n = 0;
+				return;
+			}
+		}
 		void parse_bson_element(const jvalue_type& k,const uint8_t element_type, viewvalue& bson_data)
 		{
 			switch (element_type) {
@@ -1167,13 +2644,11 @@ namespace nicehero
 			}
 			case 0x03: // object
 			{
-				init(json_type::json_object);
 				parse_bson(bson_data);
 				return;
 			}
 			case 0x04: // array
 			{
-				init(json_type::json_array);
 				parse_bson(bson_data,true);
 				return;
 			}
@@ -1183,15 +2658,24 @@ namespace nicehero
 				int32_t len{};
 				get_bson_number<int32_t>(len, bson_data);
 				m_value.init(bson_data.m_start, len + 1);
+				_keepBsonType(element_type);
 				bson_data += (len + 1);
 				return;
 			}
-			case 0x0C: // 	DBPointer Deprecated
+			case 0x0C: // 	DBPointer Deprecated, the namespace string is kept in front of the ObjectId
 			case 0x07: // 	ObjectId
 			{
+				uint32_t prefix = 0;
+				if (element_type == 0x0C) {
+					int32_t len{};
+					get_bson_number<int32_t>(len, bson_data);
+					bson_data += len;
+					prefix = sizeof(int32_t) + uint32_t(len);
+				}
 				constexpr size_t objIDSize = 12;
 				init(json_type::json_string, semantic_tag::object_id);
 				m_value.init(bson_data.m_start, objIDSize);
+				_keepBsonType(element_type, prefix);
 				bson_data += objIDSize;
 				return;
 			}
@@ -1209,6 +2693,7 @@ namespace nicehero
 				get_bson_number<uint64_t>(dt, bson_data);
 				init(json_type::json_uint64, semantic_tag::epoch_milli);
 				m_value.init(dt);
+				_keepBsonType(element_type);
 				return;
 			}
 			case 0xFF: // Min key unsupport
@@ -1217,6 +2702,9 @@ namespace nicehero
 			case 0x0A: // null
 			{
 				init(json_type::json_null);
+				if (element_type != 0x0A) {
+					_keepBsonType(element_type);
+				}
 				return;
 			}
 			case 0x0B: // Regular expression cstring cstring
@@ -1226,6 +2714,7 @@ namespace nicehero
 				jvalue_type vl;
 				get_bson_cstr(vl, bson_data);
 				m_value.m_len += vl.m_len + 1;
+				_keepBsonType(element_type);
 				return;
 			}
 			case 0x0D: // JavaScript code
@@ -1234,23 +2723,50 @@ namespace nicehero
 				int32_t len{};
 				get_bson_number<int32_t>(len, bson_data);
 				m_value.init(bson_data.m_start, len - 1);
+				_keepBsonType(element_type);
+				bson_data += len;
+				return;
+			}
+			case 0x0E: // Symbol Deprecated
+			{
+				init(json_type::json_string);
+				int32_t len{};
+				get_bson_number<int32_t>(len, bson_data);
+				m_value.init(bson_data.m_start, len - 1);
+				_keepBsonType(element_type);
 				bson_data += len;
 				return;
 			}
+			case 0x0F: // JavaScript code with scope Deprecated, the scope document is only kept for dump_bson
+			{
+				int32_t total{};
+				get_bson_number<int32_t>(total, bson_data);
+				viewvalue scope = bson_data + (total - sizeof(int32_t));
+				init(json_type::json_string, semantic_tag::code);
+				int32_t len{};
+				get_bson_number<int32_t>(len, bson_data);
+				m_value.init(bson_data.m_start, len - 1);
+				_keepBsonType(element_type);
+				bson_data = scope;
+				return;
+			}
 			case 0x10: // int32
 			{
 				int32_t value{};
 				get_bson_number(value, bson_data);
 				init(json_type::json_int64, semantic_tag::mongo_number_int);
 				m_value.init((int64_t)value);
+				//the tag is not copied with the value, the flag is
+				_keepBsonType(element_type);
 				return;
 			}
 			case 0x11: // Timestamp uint64
 			{
-				uint32_t value{};
+				uint64_t value{};
 				get_bson_number(value, bson_data);
-				init(json_type::json_uint64);
+				init(json_type::json_uint64, semantic_tag::mongo_timestamp);
 				m_value.init(value);
+				_keepBsonType(element_type);
 				return;
 			}
 			case 0x12: // int64
@@ -1266,6 +2782,7 @@ namespace nicehero
 				constexpr size_t float128_size = 16;
 				init(json_type::json_string, semantic_tag::float128);
 				m_value.init(bson_data.m_start, float128_size);
+				_keepBsonType(element_type);
 				bson_data += float128_size;
 				return;
 			}
@@ -1274,130 +2791,36 @@ namespace nicehero
 				return;
 			}
 		}
-		static void parse_bson_element_fake(const jvalue_type& k, const uint8_t element_type, viewvalue& bson_data)
-		{
-			switch (element_type) {
-			case 0x01: // double
-				bson_data += sizeof(double);
-				return;
-			case 0x02: // string
-			{
-				int32_t len{};
-				get_bson_number<int32_t>(len, bson_data);
-				bson_data += len;
-				return;
+		//elements of the lists being parsed, nested lists stack above their parent's,
+		//each list is moved out in one exactly sized allocation once its terminator is read
+		static std::vector<kjson_view>& _bsonScratch() {
+			static thread_local std::vector<kjson_view> scratch;
+			return scratch;
+		}
+
+		void parse_bson_element_list(const bool is_barray, viewvalue& bson_data) {
+			if (is_barray) {
+				init(json_type::json_array);
 			}
-			case 0x03: // object
-			case 0x04: // array
-			{
-				std::int32_t document_size{};
-				get_bson_number<int32_t>(document_size, bson_data);
-				bson_data += (document_size - sizeof(int32_t));
-				return;
-			}
-			case 0x05: // binary
-			{
-				int32_t len{};
-				get_bson_number<int32_t>(len, bson_data);
-				bson_data += (len + 1);
-				return;
-			}
-			case 0x0C: // 	DBPointer Deprecated
-			case 0x07: // 	ObjectId
-			{
-				constexpr size_t objIDSize = 12;
-				bson_data += objIDSize;
-				return;
-			}
-			case 0x08: // boolean
-			{
-				++bson_data;
-				return;
-			}
-			case 0x09: // UTC datetime
-			{
-				bson_data += sizeof(uint64_t);
-				return;
-			}
-			case 0xFF: // Min key unsupport
-			case 0x7F: // Max key unsupport
-			case 0x06: // Undefined (value)  Deprecated
-			case 0x0A: // null
-			{
-				return;
-			}
-			case 0x0B: // Regular expression cstring cstring
-			{
-				jvalue_type vl;
-				get_bson_cstr(vl, bson_data);
-				get_bson_cstr(vl, bson_data);
-				return;
-			}
-			case 0x0D: // JavaScript code
-			{
-				int32_t len{};
-				get_bson_number<int32_t>(len, bson_data);
-				bson_data += len;
-				return;
-			}
-			case 0x10: // int32
-			{
-				bson_data += sizeof(int32_t);
-				return;
-			}
-			case 0x11: // Timestamp uint64
-			{
-				bson_data += sizeof(int64_t);
-				return;
-			}
-			case 0x12: // int64
-			{
-				bson_data += sizeof(int64_t);
-				return;
-			}
-			case 0x13: // decimal128 	128-bit decimal floating point
-			{
-				constexpr size_t float128_size = 16;
-				bson_data += float128_size;
-				return;
-			}
-			default:
-				bson_data.init("");
-				return;
-			}
-		}
-
-		void parse_bson_element_list(const bool is_barray, viewvalue& bson_data) {
-			if (is_barray) {
-				init(json_type::json_array);
-			}
-			else {
-				init(json_type::json_object);
+			else {
+				init(json_type::json_object);
 			}
+			auto& scratch = _bsonScratch();
+			const size_t base = scratch.size();
 			jvalue_type k;
-			size_t element_count = 0;
-			const char* start_old = bson_data.m_start;
-			uint32_t len_old = bson_data.m_len;
-			while (auto element_type = get_bson_type(bson_data)) {
-				++bson_data;
-				get_bson_cstr(k, bson_data);
-				parse_bson_element_fake(k, element_type, bson_data);
-				++element_count;
-			}
-			m_container->reserve(element_count);
-			bson_data.m_start = start_old;
-			bson_data.m_len = len_old;
 			while (auto element_type = get_bson_type(bson_data)) {
 				++bson_data;
-				m_container->emplace_back();
 				get_bson_cstr(k, bson_data);
-				auto& kjv = m_container->back();
-				kjv.first = k;
-				kjv.second.parse_bson_element(k, element_type, bson_data);
+				json_view v;
+				v.parse_bson_element(k, element_type, bson_data);
+				scratch.emplace_back(k, std::move(v));
 			}
 			++bson_data;
+			auto memberCount = scratch.size() - base;
+			m_container->reserve(memberCount);
+			std::move(scratch.begin() + base, scratch.end(), std::back_inserter(*m_container));
+			scratch.erase(scratch.begin() + base, scratch.end());
 			if (!is_barray) {
-				auto memberCount = m_container->size();
 				m_keys->reserve(memberCount);
 				for (size_t i = 0; i < memberCount; ++i) {
 					jvalue_type& vl = m_container->at(i).first;
@@ -1432,49 +2855,294 @@ namespace nicehero
 
 		std::vector<uint8_t> dump_bson() {
 			std::vector<uint8_t> o;
-			uint8_t btype = get_bson_type();
-			dump_bson(btype, o);
+			dump_bson(get_bson_type(), o);
 			return o;
 		}
-		inline void dump_bson_string(std::vector<uint8_t>& o) {
+		//appends dump_bson() to o, clear() o to reuse it without giving its capacity back
+		void dump_bson(std::vector<uint8_t>& o) const {
+			dump_bson(get_bson_type(), o);
+		}
+		//appends the value as btype to o, container lengths are measured first so o grows once
+		void dump_bson(uint8_t btype, std::vector<uint8_t>& o) const {
+			std::vector<uint32_t> sizes;
+			size_t n = _bsonSize(btype, &sizes);
 			size_t oldSize = o.size();
-			o.resize(oldSize + sizeof(uint32_t));
-			uint32_t s = m_value.write2cstrbuffer(o) + 1;
-			write_bson_number(s, (uint32_t*)(&(o[oldSize])));
+			o.resize(oldSize + n);
+			_dumpBsonRaw(o.data() + oldSize, btype, sizes);
 		}
-		void dump_bson(uint8_t btype, std::vector<uint8_t>& o) {
+		//writes dump_bson() to buf and returns its length, nothing is written if that is over cap
+		size_t dump_bson(uint8_t* buf, size_t cap) const {
+			std::vector<uint32_t> sizes;
+			uint8_t btype = get_bson_type();
+			size_t n = _bsonSize(btype, &sizes);
+			if (n <= cap) {
+				_dumpBsonRaw(buf, btype, sizes);
+			}
+			return n;
+		}
+		void _dumpBsonRaw(uint8_t* buf, uint8_t btype, const std::vector<uint32_t>& sizes) const {
+			raw_writer w(buf);
+			const uint32_t* cur = sizes.data();
+			_dumpBson(w, btype, cur);
+		}
+		//writes dump_bson() to sink through a fixed buffer, false if the sink failed
+		bool dump_bson_to(const sink_type& sink, size_t bufferSize = sink_buffer::default_size) const {
+			std::vector<uint32_t> sizes;
+			uint8_t btype = get_bson_type();
+			_bsonSize(btype, &sizes);
+			sink_buffer w(sink, bufferSize);
+			const uint32_t* cur = sizes.data();
+			_dumpBson(w, btype, cur);
+			return w.flush();
+		}
+		bool dump_bson_to(std::ostream& os) const {
+			return dump_bson_to(ostream_sink(os));
+		}
+		template <class Writer, typename NumberType>
+		static void _writeBsonNumber(Writer& w, const NumberType n) {
+			char b[sizeof(NumberType)];
+			memcpy(b, &n, sizeof(NumberType));
+			if (!little_endianness()) {
+				std::reverse(b, b + sizeof(NumberType));
+			}
+			w.append(b, sizeof(NumberType));
+		}
+		//parsed double-quoted text is written with its escapes decoded
+		template <class Writer>
+		static void _writeBsonCString(Writer& w, const jvalue_type& s) {
+			size_t len = 0;
+			const char* p = s.string_data(len);
+			if (p && s.is_escaped()) {
+				write_json_unescaped(p, len, w);
+			}
+			else if (p) {
+				w.append(p, len);
+			}
+			w.push_back('\0');
+		}
+		//sizes holds the lengths of the containers in pre-order, as filled by _bsonSize
+		template <class Writer>
+		void _dumpBson(Writer& w, uint8_t btype, const uint32_t*& sizes) const {
+			if ((m_flags & flag_bson_verbatim) && btype == m_rawlen) {
+				if (btype == 0x09 || btype == 0x11) {
+					_writeBsonNumber(w, m_value.m_ui64);
+					return;
+				}
+				if (btype == 0x10) {
+					_writeBsonNumber(w, int32_t(m_value.m_i64));
+					return;
+				}
+				const char* p = nullptr;
+				size_t n = 0;
+				_bsonVerbatim(p, n);
+				w.append(p, n);
+				return;
+			}
 			switch (btype) {
 			case 0x01:
-				write_bson_number(m_value.m_double, o);
+				if (m_type == json_type::json_float) {
+					_writeBsonNumber(w, double(m_value.m_float));
+					break;
+				}
+				_writeBsonNumber(w, m_value.m_double);
 				break;
 			case 0x02:
-				dump_bson_string(o);
+				if (m_type == json_type::json_int128) {
+					_dumpBsonInt128(w);
+					break;
+				}
+				_writeBsonNumber(w, uint32_t(_bsonStringSize(m_value)));
+				_writeBsonCString(w, m_value);
 				break;
 			case 0x03:
-				dump_bson_object(o);
-				break;
 			case 0x04:
-				dump_bson_array(o);
+				_dumpBsonContainer(w, sizes);
 				break;
 			case 0x08:
-				if (m_value.m_boolean) {
-					o.push_back(0x01);
-				}
-				else {
-					o.push_back(0x00);
-				}
+				w.push_back(m_value.m_boolean ? 0x01 : 0x00);
 				break;
 			case 0x10:
-				write_bson_number(int32_t(m_value.m_i64), o);
+				_writeBsonNumber(w, int32_t(m_value.m_i64));
 				break;
 			case 0x12:
-				write_bson_number(m_value.m_i64, o);
+				_writeBsonNumber(w, m_value.m_i64);
+				break;
+			case 0x13:
+				_dumpBsonInt128(w);
 				break;
 			default:
 				break;
 			}
 		}
-		inline uint8_t get_bson_type() {
+		template <class Writer>
+		void _dumpBsonContainer(Writer& w, const uint32_t*& sizes) const {
+			_writeBsonNumber(w, *sizes++);
+			if (m_type == json_type::json_typed_array) {
+				size_t s = m_typed->size();
+				bool isDouble = m_typed->m_elem_type == json_type::json_double;
+				bool isFloat = m_typed->m_elem_type == json_type::json_float;
+				for (size_t i = 0; i < s && writer_good(w); ++i) {
+					w.push_back((isDouble || isFloat) ? 0x01 : 0x12);
+					bson_index_keys::write(uint32_t(i), w);
+					if (isDouble) {
+						_writeBsonNumber(w, m_typed->m_doubles[i]);
+					}
+					else if (isFloat) {
+						_writeBsonNumber(w, double(m_typed->m_floats[i]));
+					}
+					else {
+						_writeBsonNumber(w, m_typed->m_int64s[i]);
+					}
+				}
+				w.push_back('\0');
+				return;
+			}
+			bool isObject = m_type == json_type::json_object;
+			size_t s = m_container->size();
+			for (size_t i = 0; i < s && writer_good(w); ++i) {
+				auto& kv = (*m_container)[i];
+				auto& v = kv.second;
+				if (isObject && v.m_type == json_type::json_delete) {
+					continue;
+				}
+				uint8_t btype = v.get_bson_type();
+				w.push_back(char(btype));
+				if (isObject) {
+					_writeBsonCString(w, kv.first);
+				}
+				else {
+					bson_index_keys::write(uint32_t(i), w);
+				}
+				v._dumpBson(w, btype, sizes);
+			}
+			w.push_back('\0');
+		}
+		//int128 below 10^34 is written as a decimal128 with exponent 0, larger ones as decimal text
+		template <class Writer>
+		void _dumpBsonInt128(Writer& w) const {
+#if defined(NICEHERO_HAS_INT128)
+			int128_t v = as_int128();
+			uint128_t coeff = v < 0 ? uint128_t(0) - uint128_t(v) : uint128_t(v);
+			if (is_decimal128_int()) {
+				constexpr uint64_t exponent_bias = 6176;
+				uint64_t hi = uint64_t(coeff >> 64) | (exponent_bias << 49);
+				if (v < 0) {
+					hi |= uint64_t(1) << 63;
+				}
+				_writeBsonNumber(w, uint64_t(coeff));
+				_writeBsonNumber(w, hi);
+				return;
+			}
+			size_counter c;
+			from_int128(v, c);
+			_writeBsonNumber(w, uint32_t(c.size() + 1));
+			from_int128(v, w);
+			w.push_back('\0');
+#endif
+		}
+		inline bool is_decimal128_int() const {
+#if defined(NICEHERO_HAS_INT128)
+			if (m_type != json_type::json_int128) {
+				return false;
+			}
+			static const uint128_t decimal128_max = uint128_t(10000000000000000ull) * 1000000000000000000ull;
+			int128_t v = as_int128();
+			uint128_t coeff = v < 0 ? uint128_t(0) - uint128_t(v) : uint128_t(v);
+			return coeff < decimal128_max;
+#else
+			return false;
+#endif
+		}
+		//exact length of dump_bson()
+		size_t bson_size() const {
+			return _bsonSize(get_bson_type(), nullptr);
+		}
+		static inline size_t _bsonStringSize(const jvalue_type& s) {
+			size_t len = 0;
+			const char* p = s.string_data(len);
+			if (p && s.is_escaped() && memchr(p, '\\', len)) {
+				size_counter c;
+				write_json_unescaped(p, len, c);
+				len = c.size();
+			}
+			return len + 1;
+		}
+		//sizes, if given, gets the length of every container in pre-order
+		size_t _bsonSize(uint8_t btype, std::vector<uint32_t>* sizes) const {
+			if ((m_flags & flag_bson_verbatim) && btype == m_rawlen) {
+				if (btype == 0x09 || btype == 0x11) {
+					return 8;
+				}
+				if (btype == 0x10) {
+					return 4;
+				}
+				const char* p = nullptr;
+				size_t n = 0;
+				_bsonVerbatim(p, n);
+				return n;
+			}
+			switch (btype) {
+			case 0x01:
+			case 0x12:
+				return 8;
+			case 0x02: {
+#if defined(NICEHERO_HAS_INT128)
+				if (m_type == json_type::json_int128) {
+					size_counter c;
+					from_int128(as_int128(), c);
+					return sizeof(uint32_t) + c.size() + 1;
+				}
+#endif
+				return sizeof(uint32_t) + _bsonStringSize(m_value);
+			}
+			case 0x03:
+			case 0x04:
+				break;
+			case 0x08:
+				return 1;
+			case 0x10:
+				return 4;
+			case 0x13:
+				return 16;
+			default:
+				return 0;
+			}
+			size_t slot = 0;
+			if (sizes) {
+				slot = sizes->size();
+				sizes->push_back(0);
+			}
+			size_t r = sizeof(uint32_t) + 1;
+			if (m_type == json_type::json_typed_array) {
+				size_t s = m_typed->size();
+				r += s * (1 + 8) + bson_index_keys::total_size(s);
+			}
+			else {
+				size_t s = m_container->size();
+				if (m_type == json_type::json_array) {
+					r += s + bson_index_keys::total_size(s);
+				}
+				for (size_t i = 0; i < s; ++i) {
+					auto& kv = (*m_container)[i];
+					auto& v = kv.second;
+					if (m_type == json_type::json_object) {
+						if (v.m_type == json_type::json_delete) {
+							continue;
+						}
+						r += 1 + _bsonStringSize(kv.first);
+					}
+					r += v._bsonSize(v.get_bson_type(), sizes);
+				}
+			}
+			if (sizes) {
+				(*sizes)[slot] = uint32_t(r);
+			}
+			return r;
+		}
+		inline uint8_t get_bson_type() const {
+			if (m_flags & flag_bson_verbatim) {
+				return m_rawlen;
+			}
 			if (is_object()) {
 				return 0x03;
 			}
@@ -1484,6 +3152,12 @@ namespace nicehero
 			if (is_string()) {
 				return 0x02;
 			}
+			if (m_type == json_type::json_int128) {
+				return is_decimal128_int() ? 0x13 : 0x02;
+			}
+			if (m_type == json_type::json_bignum) {
+				return 0x02;
+			}
 			if (is_integer()) {
 				if (m_tag == semantic_tag::mongo_number_int) {
 					return 0x10;
@@ -1501,86 +3175,516 @@ namespace nicehero
 			}
 			return 0;
 		}
-		void dump_bson_object(std::vector<uint8_t>& o) {
-			uint32_t s = uint32_t(m_container->size());
-			size_t oldSize = o.size();
-			o.resize(oldSize + sizeof(uint32_t));
-			for (size_t i = 0; i < s; ++ i) {
-				auto& kv = (*m_container)[i];
-				auto& v = kv.second;
-				if (v.m_type == json_type::json_delete) {
+
+		inline bool is_object() const {
+			expand_raw();
+			return m_type == json_type::json_object;
+		}
+		inline bool is_array() const {
+			expand_raw();
+			return m_type == json_type::json_array || m_type == json_type::json_typed_array;
+		}
+		inline bool is_typed_array() const {
+			return m_type == json_type::json_typed_array;
+		}
+		//element type of a typed array, json_int64, json_double or json_float
+		inline json_type typed_array_type() const {
+			if (m_type == json_type::json_typed_array) {
+				return m_typed->m_elem_type;
+			}
+			return json_type::json_null;
+		}
+		//empty if not a typed array of int64
+		inline array_span<const int64_t> as_int64_array() const {
+			if (m_type == json_type::json_typed_array && m_typed->m_elem_type == json_type::json_int64) {
+				return array_span<const int64_t>(m_typed->m_int64s.data(), m_typed->m_int64s.size());
+			}
+			return array_span<const int64_t>();
+		}
+		inline array_span<int64_t> as_int64_array() {
+			if (m_type == json_type::json_typed_array && m_typed->m_elem_type == json_type::json_int64) {
+				return array_span<int64_t>(m_typed->m_int64s.data(), m_typed->m_int64s.size());
+			}
+			return array_span<int64_t>();
+		}
+		//empty if not a typed array of double
+		inline array_span<const double> as_double_array() const {
+			if (m_type == json_type::json_typed_array && m_typed->m_elem_type == json_type::json_double) {
+				return array_span<const double>(m_typed->m_doubles.data(), m_typed->m_doubles.size());
+			}
+			return array_span<const double>();
+		}
+		inline array_span<double> as_double_array() {
+			if (m_type == json_type::json_typed_array && m_typed->m_elem_type == json_type::json_double) {
+				return array_span<double>(m_typed->m_doubles.data(), m_typed->m_doubles.size());
+			}
+			return array_span<double>();
+		}
+		//empty if not a typed array of float
+		inline array_span<const float> as_float_array() const {
+			if (m_type == json_type::json_typed_array && m_typed->m_elem_type == json_type::json_float) {
+				return array_span<const float>(m_typed->m_floats.data(), m_typed->m_floats.size());
+			}
+			return array_span<const float>();
+		}
+		inline array_span<float> as_float_array() {
+			if (m_type == json_type::json_typed_array && m_typed->m_elem_type == json_type::json_float) {
+				return array_span<float>(m_typed->m_floats.data(), m_typed->m_floats.size());
+			}
+			return array_span<float>();
+		}
+		//convert an array of only integers, only doubles or only floats to typed_array storage
+		bool make_typed_array() {
+			if (m_type == json_type::json_typed_array) {
+				return true;
+			}
+			if (m_type != json_type::json_array || m_container->size() < 1) {
+				return false;
+			}
+			typed_array ta;
+			for (auto& kjv : *m_container) {
+				const json_view& v = kjv.second;
+				if (!v.is_number() || v.m_type == json_type::json_int128 || v.m_type == json_type::json_bignum) {
+					return false;
+				}
+				if (v.m_type == json_type::json_uint64 && v.m_value.m_ui64 > uint64_t(INT64_MAX)) {
+					return false;
+				}
+				json_type elemType = (v.m_type == json_type::json_double || v.m_type == json_type::json_float) ? v.m_type : json_type::json_int64;
+				if (&kjv == &m_container->front()) {
+					ta.m_elem_type = elemType;
+				}
+				else if (elemType != ta.m_elem_type) {
+					return false;
+				}
+			}
+			if (ta.m_elem_type == json_type::json_double) {
+				ta.m_doubles.reserve(m_container->size());
+				for (auto& kjv : *m_container) {
+					ta.m_doubles.push_back(kjv.second.as_number());
+				}
+			}
+			else if (ta.m_elem_type == json_type::json_float) {
+				ta.m_floats.reserve(m_container->size());
+				for (auto& kjv : *m_container) {
+					ta.m_floats.push_back(kjv.second.as_float());
+				}
+			}
+			else {
+				ta.m_int64s.reserve(m_container->size());
+				for (auto& kjv : *m_container) {
+					ta.m_int64s.push_back(kjv.second.as_int64());
+				}
+			}
+			init(json_type::json_null);
+			m_typed = new typed_array(std::move(ta));
+			m_type = json_type::json_typed_array;
+			return true;
+		}
+		//pre-serialized JSON that dump writes out as is, it is parsed the first time it is accessed
+		//the text is viewed unless copy is set and copied when it is parsed,
+		//validate rejects text that is_valid_json rejects
+		bool set_raw(const char* s, size_t len, bool copy = false, bool validate = false) {
+			if (validate && !is_valid_json(s, len)) {
+				return false;
+			}
+			while (len > 0 && ((*s >= '\t' && *s <= '\r') || *s == ' ')) {
+				++s;
+				--len;
+			}
+			len = rstrip(s, len);
+			init(json_type::json_null);
+			auto* container = new container_type();
+			if (copy) {
+				container->m_keep = std::make_shared<const std::string>(s, len);
+				s = container->m_keep->data();
+			}
+			container->m_source = s;
+			container->m_sourceLen = len;
+			m_container = container;
+			m_keys = nullptr;
+			m_type = json_type::json_raw;
+			return true;
+		}
+		bool set_raw(const std::string& s, bool validate = false) {
+			return set_raw(s.data(), s.size(), true, validate);
+		}
+		inline bool is_raw() const {
+			return m_type == json_type::json_raw;
+		}
+		//whether s[0, len) is exactly one JSON value by RFC 8259, stricter than parse: no single quotes,
+		//bare words, trailing commas or unknown escapes, strings are UTF-8, maxDepth bounds the nesting
+		static bool is_valid_json(const char* s, size_t len, int maxDepth = 100) {
+			const char* end = s + len;
+			const char* p = _skipJsonSpace(s, end);
+			if (!_validateJsonValue(p, end, maxDepth)) {
+				return false;
+			}
+			return _skipJsonSpace(p, end) == end;
+		}
+		static const char* _skipJsonSpace(const char* p, const char* end) {
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+				++p;
+			}
+			return p;
+		}
+		//checks the value at p and moves p past it, nothing at or after end is read
+		static bool _validateJsonValue(const char*& p, const char* end, int depth) {
+			if (p >= end) {
+				return false;
+			}
+			switch (*p) {
+			case '{':
+			case '[':
+			{
+				if (depth <= 0) {
+					return false;
+				}
+				bool isObject = *p == '{';
+				char close = isObject ? '}' : ']';
+				p = _skipJsonSpace(p + 1, end);
+				if (p < end && *p == close) {
+					++p;
+					return true;
+				}
+				while (true) {
+					if (isObject) {
+						if (p >= end || *p != '"' || !_validateJsonString(p, end)) {
+							return false;
+						}
+						p = _skipJsonSpace(p, end);
+						if (p >= end || *p != ':') {
+							return false;
+						}
+						p = _skipJsonSpace(p + 1, end);
+					}
+					if (!_validateJsonValue(p, end, depth - 1)) {
+						return false;
+					}
+					p = _skipJsonSpace(p, end);
+					if (p >= end) {
+						return false;
+					}
+					if (*p == close) {
+						++p;
+						return true;
+					}
+					if (*p != ',') {
+						return false;
+					}
+					p = _skipJsonSpace(p + 1, end);
+				}
+			}
+			case '"':
+				return _validateJsonString(p, end);
+			case 't':
+				return _validateJsonWord(p, end, "true", 4);
+			case 'f':
+				return _validateJsonWord(p, end, "false", 5);
+			case 'n':
+				return _validateJsonWord(p, end, "null", 4);
+			default:
+				return _validateJsonNumber(p, end);
+			}
+		}
+		static bool _validateJsonWord(const char*& p, const char* end, const char* word, size_t n) {
+			if (size_t(end - p) < n || memcmp(p, word, n) != 0) {
+				return false;
+			}
+			p += n;
+			return true;
+		}
+		static bool _validateJsonDigits(const char*& p, const char* end) {
+			const char* start = p;
+			while (p < end && *p >= '0' && *p <= '9') {
+				++p;
+			}
+			return p != start;
+		}
+		static bool _validateJsonNumber(const char*& p, const char* end) {
+			if (p < end && *p == '-') {
+				++p;
+			}
+			if (p < end && *p == '0') {
+				++p;
+			}
+			else if (p >= end || *p < '1' || *p > '9' || !_validateJsonDigits(p, end)) {
+				return false;
+			}
+			if (p < end && *p == '.') {
+				++p;
+				if (!_validateJsonDigits(p, end)) {
+					return false;
+				}
+			}
+			if (p < end && (*p == 'e' || *p == 'E')) {
+				++p;
+				if (p < end && (*p == '+' || *p == '-')) {
+					++p;
+				}
+				if (!_validateJsonDigits(p, end)) {
+					return false;
+				}
+			}
+			return true;
+		}
+		//p is at the opening quote
+		static bool _validateJsonString(const char*& p, const char* end) {
+			++p;
+			while (p < end) {
+				uint8_t c = uint8_t(*p);
+				if (c == '"') {
+					++p;
+					return true;
+				}
+				if (c < 0x20) {
+					return false;
+				}
+				if (c == '\\') {
+					++p;
+					if (p >= end) {
+						return false;
+					}
+					uint32_t cp = 0;
+					switch (*p) {
+					case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+						++p;
+						break;
+					case 'u':
+						if (!json_hex4(p + 1, size_t(end - p - 1), cp)) {
+							return false;
+						}
+						p += 5;
+						break;
+					default:
+						return false;
+					}
 					continue;
 				}
-				uint8_t btype = v.get_bson_type();
-				o.push_back(btype);
-				kv.first.write2cstrbuffer(o);
-				v.dump_bson(btype, o);
+				if (c < 0x80) {
+					++p;
+					continue;
+				}
+				size_t n = _utf8SequenceLength((const uint8_t*)p, (const uint8_t*)end);
+				if (n == 0) {
+					return false;
+				}
+				p += n;
 			}
-			o.push_back(0x00);
-			write_bson_number(uint32_t(o.size() - oldSize), (uint32_t*)(&(o[oldSize])));
+			return false;
 		}
-		void dump_bson_array(std::vector<uint8_t>& o) {
-			uint32_t s = uint32_t(m_container->size());
-			size_t oldSize = o.size();
-			o.resize(oldSize + sizeof(uint32_t));
-			for (size_t i = 0; i < s; ++i) {
-				auto& kv = (*m_container)[i];
-				auto& v = kv.second;
-				uint8_t btype = v.get_bson_type();
-				o.push_back(btype);
-				from_integer(uint32_t(i), o);
-				o.push_back(0x00);
-				v.dump_bson(btype, o);
+		//bytes of the well-formed UTF-8 sequence at p, 0 for overlongs, surrogates and stray bytes
+		static size_t _utf8SequenceLength(const uint8_t* p, const uint8_t* end) {
+			uint8_t c = p[0];
+			size_t n = 0;
+			uint8_t lo = 0x80;
+			uint8_t hi = 0xBF;
+			if (c >= 0xC2 && c <= 0xDF) {
+				n = 2;
+			}
+			else if (c >= 0xE0 && c <= 0xEF) {
+				n = 3;
+				lo = c == 0xE0 ? 0xA0 : 0x80;
+				hi = c == 0xED ? 0x9F : 0xBF;
+			}
+			else if (c >= 0xF0 && c <= 0xF4) {
+				n = 4;
+				lo = c == 0xF0 ? 0x90 : 0x80;
+				hi = c == 0xF4 ? 0x8F : 0xBF;
+			}
+			else {
+				return 0;
+			}
+			if (size_t(end - p) < n || p[1] < lo || p[1] > hi) {
+				return 0;
 			}
-			o.push_back(0x00);
-			write_bson_number(uint32_t(o.size() - oldSize), (uint32_t*)(&(o[oldSize])));
+			for (size_t i = 2; i < n; ++i) {
+				if (p[i] < 0x80 || p[i] > 0xBF) {
+					return 0;
+				}
+			}
+			return n;
 		}
-
-		inline bool is_object() const {
-			return m_type == json_type::json_object;
+		//parses the value in s[0, len), end gets where the parse stopped
+		bool _parseFragment(const char* s, size_t len, bool isLazy, uint32_t flags, const char*& end) {
+			while (len > 0 && ((*s >= '\t' && *s <= '\r') || *s == ' ')) {
+				++s;
+				--len;
+			}
+			len = rstrip(s, len);
+			if (len < 1) {
+				return false;
+			}
+			if (*s == '{') {
+				init(json_type::json_object);
+				end = _parseObject(s, isLazy, flags);
+				return end != nullptr;
+			}
+			if (*s == '[') {
+				init(json_type::json_array);
+				end = _parseArray(s, isLazy, flags);
+				return end != nullptr;
+			}
+			init(json_type::json_null);
+			m_type = json_type::json_lazy;
+			m_value.init(s, uint32_t(len));
+			end = s + len;
+			return check_type();
+		}
+		//decodes the escapes of JSON string text, \u included
+		static std::string _unescape(const char* s, size_t len) {
+			std::string r;
+			r.reserve(len);
+			write_json_unescaped(s, len, r);
+			return r;
+		}
+		//parses a json_raw fragment in place, false if its text is not JSON
+		bool expand_raw() const {
+			if (m_type != json_type::json_raw) {
+				return true;
+			}
+			const container_type* raw = m_container;
+			//the parser reads up to a NUL, so a viewed span is copied before it is parsed
+			std::shared_ptr<const std::string> keep = raw->m_keep;
+			if (!keep) {
+				keep = std::make_shared<const std::string>(raw->m_source, raw->m_sourceLen);
+			}
+			json_view t;
+			const char* end = nullptr;
+			if (!t._parseFragment(keep->c_str(), keep->size(), true, parse_keep_source, end)) {
+				return false;
+			}
+			if (t.m_type == json_type::json_object || t.m_type == json_type::json_array) {
+				t.m_container->m_keep = keep;
+			}
+			else if (t.m_type == json_type::json_string) {
+				//the copied text goes away with the fragment and owned strings are never escaped
+				size_t len = 0;
+				const char* p = t.m_value.string_data(len);
+				t = t.m_value.is_escaped() ? _unescape(p, len) : std::string(p, len);
+			}
+			else if (t.m_type == json_type::json_bignum) {
+				t.m_value.init(copy_str_ref(t.m_value.m_start, t.m_value.m_len));
+			}
+			json_view* self = const_cast<json_view*>(this);
+			semantic_tag tag = t.m_tag;
+			self->init(json_type::json_null);
+			*self = std::move(t);
+			m_tag = tag;
+			return true;
 		}
-		inline bool is_array() const {
-			return m_type == json_type::json_array;
+		//convert typed_array storage back to json_view elements, const access reads it in place
+		void expand_typed_array() {
+			if (m_type != json_type::json_typed_array) {
+				return;
+			}
+			typed_array* ta = m_typed;
+			auto* container = new container_type(ta->size());
+			for (size_t i = 0; i < ta->size(); ++i) {
+				if (ta->m_elem_type == json_type::json_double) {
+					(*container)[i].second = ta->m_doubles[i];
+				}
+				else if (ta->m_elem_type == json_type::json_float) {
+					(*container)[i].second = ta->m_floats[i];
+				}
+				else {
+					(*container)[i].second = ta->m_int64s[i];
+				}
+			}
+			delete ta;
+			m_container = container;
+			m_keys = nullptr;
+			m_type = json_type::json_array;
 		}
+		//an integer as_int64 or as_uint64 returns exactly, see is_int128 and is_bignum for larger ones
 		inline bool is_integer() const {
-			if (m_type == json_type::json_lazy) {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
 				check_type();
 			}
+			if (m_type == json_type::json_int128) {
+				uint64_t hi = _int128High();
+				return hi == 0 || (hi == UINT64_MAX && m_value.m_ui64 > uint64_t(INT64_MAX));
+			}
 			return m_type == json_type::json_uint64 || m_type == json_type::json_int64;
 		}
+		//high 64 bits of a json_int128, see _storeInt128
+		inline uint64_t _int128High() const {
+			return (uint64_t(m_rawhi) << 32) | m_value.m_len;
+		}
 		inline bool is_number() const {
-			if (m_type == json_type::json_lazy) {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
+				check_type();
+			}
+			return m_type == json_type::json_uint64 || m_type == json_type::json_int64 || m_type == json_type::json_double
+				|| m_type == json_type::json_float || m_type == json_type::json_int128 || m_type == json_type::json_bignum;
+		}
+		inline bool is_int128() const {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
 				check_type();
 			}
-			return m_type == json_type::json_uint64 || m_type == json_type::json_int64 || m_type == json_type::json_double;
+			return m_type == json_type::json_int128;
+		}
+		//bigint or bigdec that is kept as decimal text
+		inline bool is_bignum() const {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
+				check_type();
+			}
+			return m_type == json_type::json_bignum;
 		}
 		inline bool is_double() const {
-			if (m_type == json_type::json_lazy) {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
 				check_type();
 			}
-			return m_type == json_type::json_double;
+			return m_type == json_type::json_double || m_type == json_type::json_float;
+		}
+		//decimals a double is dumped with, 0 for the default shortest form
+		inline int fixed_precision() const {
+			if (m_tag < semantic_tag::fixed1 || m_tag > semantic_tag::fixed9) {
+				return 0;
+			}
+			if (m_type != json_type::json_double && m_type != json_type::json_float) {
+				return 0;
+			}
+			return int(m_tag) - int(semantic_tag::fixed1) + 1;
+		}
+		//precision 1..9 tags this double as fixedN, 0 restores the shortest form
+		void set_fixed_precision(int precision) {
+			if (!is_double()) {
+				return;
+			}
+			if (precision < 1 || precision > 9) {
+				m_tag = semantic_tag::none;
+				return;
+			}
+			m_tag = semantic_tag(int(semantic_tag::fixed1) + precision - 1);
+		}
+		inline bool is_float() const {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
+				check_type();
+			}
+			return m_type == json_type::json_float;
 		}
 		inline bool is_string() const {
-			if (m_type == json_type::json_lazy) {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
 				check_type();
 			}
 			return m_type == json_type::json_string;
 		}
 		inline bool is_boolean() const {
-			if (m_type == json_type::json_lazy) {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
 				check_type();
 			}
 			return m_type == json_type::json_boolean;
 		}
 		inline bool is_null() const {
-			if (m_type == json_type::json_lazy) {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
 				check_type();
 			}
 			return m_type == json_type::json_null;
 		}
 
 		inline uint64_t as_uint64() const {
-			if (m_type == json_type::json_lazy) {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
 				check_type();
 			}
 			if (m_type == json_type::json_uint64) {
@@ -1592,11 +3696,22 @@ namespace nicehero
 			if (m_type == json_type::json_double) {
 				return (uint64_t)m_value.m_double;
 			}
+			if (m_type == json_type::json_float) {
+				return (uint64_t)m_value.m_float;
+			}
+			if (m_type == json_type::json_int128) {
+				//clamped to 0 or UINT64_MAX out of range
+				uint64_t hi = _int128High();
+				if (hi == 0) {
+					return m_value.m_ui64;
+				}
+				return (hi >> 63) ? 0 : UINT64_MAX;
+			}
 			return 0;
 		}
 
 		inline int64_t as_int64() const {
-			if (m_type == json_type::json_lazy) {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
 				check_type();
 			}
 			if (m_type == json_type::json_int64) {
@@ -1608,27 +3723,90 @@ namespace nicehero
 			if (m_type == json_type::json_double) {
 				return (int64_t)m_value.m_double;
 			}
+			if (m_type == json_type::json_float) {
+				return (int64_t)m_value.m_float;
+			}
+			if (m_type == json_type::json_int128) {
+				//clamped to INT64_MIN or INT64_MAX out of range
+				uint64_t hi = _int128High();
+				if ((hi == 0 && m_value.m_ui64 <= uint64_t(INT64_MAX))
+					|| (hi == UINT64_MAX && m_value.m_ui64 > uint64_t(INT64_MAX))) {
+					return m_value.m_i64;
+				}
+				return (hi >> 63) ? INT64_MIN : INT64_MAX;
+			}
 			return 0;
 		}
+#if defined(NICEHERO_HAS_INT128)
+		inline int128_t as_int128() const {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
+				check_type();
+			}
+			if (m_type == json_type::json_int128) {
+				uint64_t hi = (uint64_t(m_rawhi) << 32) | m_value.m_len;
+				return int128_t((uint128_t(hi) << 64) | m_value.m_ui64);
+			}
+			if (m_type == json_type::json_uint64) {
+				return (int128_t)m_value.m_ui64;
+			}
+			if (m_type == json_type::json_double) {
+				return (int128_t)m_value.m_double;
+			}
+			return (int128_t)as_int64();
+		}
+#endif
+		//decimal text of a bigint or bigdec
+		inline jvalue_type as_bignum() const {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
+				check_type();
+			}
+			if (m_type == json_type::json_bignum) {
+				return m_value;
+			}
+			return jvalue_type();
+		}
 
 		inline double as_number() const {
-			if (m_type == json_type::json_lazy) {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
 				check_type();
 			}
 			if (m_type == json_type::json_double) {
 				return m_value.m_double;
 			}
+			if (m_type == json_type::json_float) {
+				return (double)m_value.m_float;
+			}
 			if (m_type == json_type::json_int64) {
 				return (double)m_value.m_i64;
 			}
 			if (m_type == json_type::json_uint64) {
 				return (double)m_value.m_ui64;
 			}
+#if defined(NICEHERO_HAS_INT128)
+			if (m_type == json_type::json_int128) {
+				return (double)as_int128();
+			}
+#endif
+			if (m_type == json_type::json_bignum) {
+				double t = 0;
+				strtod_c(m_value.m_start, m_value.m_len, t);
+				return t;
+			}
 			return 0;
 		}
 
+		inline float as_float() const {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
+				check_type();
+			}
+			if (m_type == json_type::json_float) {
+				return m_value.m_float;
+			}
+			return (float)as_number();
+		}
+
 		inline std::string as_string() const {
-			if (m_type == json_type::json_lazy) {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
 				check_type();
 			}
 			if (m_type == json_type::json_string) {
@@ -1637,7 +3815,7 @@ namespace nicehero
 			return "";
 		}
 		inline bool as_boolean() const {
-			if (m_type == json_type::json_lazy) {
+			if (m_type == json_type::json_lazy || m_type == json_type::json_raw) {
 				check_type();
 			}
 			if (m_type == json_type::json_boolean) {
@@ -1652,12 +3830,18 @@ namespace nicehero
 			mutable jvalue_type m_value;
 			struct  
 			{
-				std::vector<kjson_view>* m_container;
+				container_type* m_container;
 				keys_type* m_keys;
 			};
+			typed_array* m_typed;
 		};
 		mutable json_type m_type = json_type::json_null;
 		mutable semantic_tag m_tag = semantic_tag::none;
+		mutable uint8_t m_flags = 0;
+		//raw number length and high pointer bits, see set_raw_number, m_rawhi also keeps int128 bits, see _storeInt128
+		//with flag_bson_verbatim they are the BSON type and the bytes in front of m_value, see _keepBsonType
+		mutable uint8_t m_rawlen = 0;
+		mutable uint32_t m_rawhi = 0;
 		//fields end
 	};
 	static const json_view null_json_view;
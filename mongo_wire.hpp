@@ -0,0 +1,340 @@
+#ifndef __NICEHERO_MONGO_WIRE__
+#define __NICEHERO_MONGO_WIRE__
+#include "bson_view.hpp"
+
+namespace nicehero
+{
+	//BSON documents packed back to back, an OP_MSG document sequence or the OP_REPLY documents
+	//viewed in place, the framing is checked when the message is parsed
+	class bson_sequence {
+	public:
+		using jvalue_type = viewvalue;
+
+		class iterator {
+		public:
+			inline bool operator == (const iterator& rhs) const {
+				return m_cur == rhs.m_cur;
+			}
+			inline bool operator != (const iterator& rhs) const {
+				return m_cur != rhs.m_cur;
+			}
+			inline iterator& operator++() {
+				m_cur += _size();
+				return *this;
+			}
+			inline iterator operator++(int) {
+				auto rit = *this;
+				++(*this);
+				return rit;
+			}
+			bson_view operator*() const {
+				return bson_view(m_cur, _size());
+			}
+		private:
+			friend class bson_sequence;
+			iterator(const uint8_t* cur) : m_cur(cur) {}
+			size_t _size() const {
+				return size_t(bson_view::load<int32_t>(m_cur));
+			}
+			const uint8_t* m_cur = nullptr;
+		};
+
+		bson_sequence() {}
+		bson_sequence(const uint8_t* data, size_t len, const jvalue_type& identifier = jvalue_type())
+			: m_data(data), m_size(len), m_identifier(identifier) {
+		}
+		//false unless every document length is sane and they cover len exactly
+		static bool framed(const uint8_t* data, size_t len) {
+			size_t off = 0;
+			while (off < len) {
+				if (len - off < 5) {
+					return false;
+				}
+				int32_t n = bson_view::load<int32_t>(data + off);
+				if (n < 5 || size_t(n) > len - off || data[off + size_t(n) - 1] != 0) {
+					return false;
+				}
+				off += size_t(n);
+			}
+			return true;
+		}
+		//the OP_MSG sequence name, such as "documents", empty for OP_REPLY
+		const jvalue_type& identifier() const {
+			return m_identifier;
+		}
+		iterator begin() const {
+			return iterator(m_data);
+		}
+		iterator end() const {
+			return iterator(m_data + m_size);
+		}
+		bool empty() const {
+			return m_size == 0;
+		}
+		//walks the documents
+		size_t size() const {
+			size_t n = 0;
+			for (auto it = begin(); it != end(); ++it) {
+				++n;
+			}
+			return n;
+		}
+		const uint8_t* data() const {
+			return m_data;
+		}
+		size_t bytes() const {
+			return m_size;
+		}
+	private:
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+		jvalue_type m_identifier;
+	};
+
+	//one OP_MSG or OP_REPLY frame of the MongoDB wire protocol read in place,
+	//the documents are framed but not validated, run validate_bson on untrusted traffic
+	class mongo_message {
+	public:
+		using jvalue_type = viewvalue;
+		static constexpr int32_t op_reply = 1;
+		static constexpr int32_t op_compressed = 2012;
+		static constexpr int32_t op_msg = 2013;
+		static constexpr uint32_t checksum_present = 1u << 0;
+		static constexpr uint32_t more_to_come = 1u << 1;
+		static constexpr uint32_t exhaust_allowed = 1u << 16;
+		static constexpr size_t header_size = 16;
+		static constexpr size_t npos = size_t(-1);
+
+		mongo_message() {}
+		mongo_message(const uint8_t* data, size_t len) {
+			parse(data, len);
+		}
+		//bytes of the message starting at data, 0 until the length prefix is in, npos if the
+		//length is shorter than a header and the stream cannot be framed any further
+		//a stream reader waits until that many bytes are buffered
+		static size_t message_size(const uint8_t* data, size_t len) {
+			if (len < 4) {
+				return 0;
+			}
+			int32_t n = bson_view::load<int32_t>(data);
+			return n < int32_t(header_size) ? npos : size_t(n);
+		}
+		//false if data does not start with a whole, well-framed OP_MSG or OP_REPLY,
+		//the header fields are still read when the length and op code are what failed
+		bool parse(const uint8_t* data, size_t len) {
+			*this = mongo_message();
+			if (len < header_size) {
+				return false;
+			}
+			m_data = data;
+			m_size = size_t(bson_view::load<int32_t>(data));
+			m_requestId = bson_view::load<int32_t>(data + 4);
+			m_responseTo = bson_view::load<int32_t>(data + 8);
+			m_opCode = bson_view::load<int32_t>(data + 12);
+			if (m_size < header_size || m_size > len) {
+				return false;
+			}
+			if (m_opCode == op_msg) {
+				m_valid = _parseMsg();
+			}
+			else if (m_opCode == op_reply) {
+				m_valid = _parseReply();
+			}
+			return m_valid;
+		}
+		bool valid() const {
+			return m_valid;
+		}
+		const uint8_t* data() const {
+			return m_data;
+		}
+		//messageLength, the bytes to skip to the next message
+		size_t size() const {
+			return m_size;
+		}
+		int32_t request_id() const {
+			return m_requestId;
+		}
+		int32_t response_to() const {
+			return m_responseTo;
+		}
+		int32_t op_code() const {
+			return m_opCode;
+		}
+		//OP_MSG flagBits or OP_REPLY responseFlags
+		uint32_t flags() const {
+			return m_flags;
+		}
+		bool has_checksum() const {
+			return m_opCode == op_msg && (m_flags & checksum_present);
+		}
+		//CRC-32C as sent, not verified
+		uint32_t checksum() const {
+			return has_checksum() ? bson_view::load<uint32_t>(m_data + m_size - 4) : 0;
+		}
+		//the OP_MSG body section, for OP_REPLY the first document
+		const bson_view& body() const {
+			return m_body;
+		}
+		//OP_MSG document sequences in message order
+		size_t sequence_count() const {
+			return m_sequenceCount;
+		}
+		//empty sequence past the end
+		bson_sequence sequence(size_t i) const {
+			bson_sequence r;
+			_forSequences([&](const bson_sequence& s) {
+				if (i-- == 0) {
+					r = s;
+					return false;
+				}
+				return true;
+			});
+			return r;
+		}
+		//empty sequence if no section has that identifier
+		bson_sequence find_sequence(const jvalue_type& identifier) const {
+			bson_sequence r;
+			_forSequences([&](const bson_sequence& s) {
+				if (s.identifier().m_len == identifier.m_len
+					&& memcmp(s.identifier().m_start, identifier.m_start, identifier.m_len) == 0) {
+					r = s;
+					return false;
+				}
+				return true;
+			});
+			return r;
+		}
+		bson_sequence find_sequence(const char* identifier) const {
+			return find_sequence(jvalue_type(identifier, uint32_t(strlen(identifier))));
+		}
+		//OP_REPLY fields and documents
+		int64_t cursor_id() const {
+			return m_cursorId;
+		}
+		int32_t starting_from() const {
+			return m_startingFrom;
+		}
+		int32_t number_returned() const {
+			return m_numberReturned;
+		}
+		const bson_sequence& documents() const {
+			return m_documents;
+		}
+	private:
+		bool _parseMsg() {
+			if (m_size < header_size + 4) {
+				return false;
+			}
+			m_flags = bson_view::load<uint32_t>(m_data + header_size);
+			m_sections = header_size + 4;
+			m_sectionsEnd = m_size;
+			if (m_flags & checksum_present) {
+				if (m_sectionsEnd < m_sections + 4) {
+					return false;
+				}
+				m_sectionsEnd -= 4;
+			}
+			size_t bodies = 0;
+			size_t p = m_sections;
+			while (p < m_sectionsEnd) {
+				uint8_t kind = m_data[p++];
+				if (m_sectionsEnd - p < 5) {
+					return false;
+				}
+				int32_t n = bson_view::load<int32_t>(m_data + p);
+				if (n < 5 || size_t(n) > m_sectionsEnd - p) {
+					return false;
+				}
+				if (kind == 0) {
+					if (m_data[p + size_t(n) - 1] != 0 || ++bodies > 1) {
+						return false;
+					}
+					m_body = bson_view(m_data + p, size_t(n));
+				}
+				else if (kind == 1) {
+					bson_sequence s;
+					if (!_readSequence(p, size_t(n), s)) {
+						return false;
+					}
+					++m_sequenceCount;
+				}
+				else {
+					return false;
+				}
+				p += size_t(n);
+			}
+			return bodies == 1;
+		}
+		//a kind 1 section at p: int32 size, cstring identifier, documents
+		bool _readSequence(size_t p, size_t n, bson_sequence& s) const {
+			const uint8_t* id = m_data + p + 4;
+			auto idEnd = (const uint8_t*)memchr(id, 0, n - 4);
+			if (!idEnd) {
+				return false;
+			}
+			const uint8_t* docs = idEnd + 1;
+			size_t docsSize = size_t(m_data + p + n - docs);
+			if (!bson_sequence::framed(docs, docsSize)) {
+				return false;
+			}
+			s = bson_sequence(docs, docsSize, jvalue_type((const char*)id, uint32_t(idEnd - id)));
+			return true;
+		}
+		//calls f(sequence) for each kind 1 section until it returns false, the sections were checked by parse
+		template <class F>
+		void _forSequences(const F& f) const {
+			if (!m_valid || m_opCode != op_msg) {
+				return;
+			}
+			size_t p = m_sections;
+			while (p < m_sectionsEnd) {
+				uint8_t kind = m_data[p++];
+				size_t n = size_t(bson_view::load<int32_t>(m_data + p));
+				if (kind == 1) {
+					bson_sequence s;
+					_readSequence(p, n, s);
+					if (!f(s)) {
+						return;
+					}
+				}
+				p += n;
+			}
+		}
+		bool _parseReply() {
+			constexpr size_t fixed = header_size + 20;
+			if (m_size < fixed) {
+				return false;
+			}
+			m_flags = bson_view::load<uint32_t>(m_data + header_size);
+			m_cursorId = bson_view::load<int64_t>(m_data + header_size + 4);
+			m_startingFrom = bson_view::load<int32_t>(m_data + header_size + 12);
+			m_numberReturned = bson_view::load<int32_t>(m_data + header_size + 16);
+			if (!bson_sequence::framed(m_data + fixed, m_size - fixed)) {
+				return false;
+			}
+			m_documents = bson_sequence(m_data + fixed, m_size - fixed);
+			if (!m_documents.empty()) {
+				m_body = *m_documents.begin();
+			}
+			return true;
+		}
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+		int32_t m_requestId = 0;
+		int32_t m_responseTo = 0;
+		int32_t m_opCode = 0;
+		uint32_t m_flags = 0;
+		bool m_valid = false;
+		bson_view m_body;
+		size_t m_sections = 0;
+		size_t m_sectionsEnd = 0;
+		size_t m_sequenceCount = 0;
+		int64_t m_cursorId = 0;
+		int32_t m_startingFrom = 0;
+		int32_t m_numberReturned = 0;
+		bson_sequence m_documents;
+	};
+}
+
+#endif
@@ -18,6 +18,10 @@
 #include <type_traits> // std::enable_if
 #include <exception>
 #include <cctype>
+#include <cfloat> // FLT_MIN
+#include <cstring>
+#include <stdlib.h> // strtof
+#include <clocale> // localeconv
 
 #if defined(_MSC_VER)
 #define NICEHERO_HAS_MSC_STRTOD_L
@@ -28,15 +32,26 @@
 #else
 #define NICEHERO_NO_LOCALECONV
 #endif
+#elif defined(__GLIBC__)
+#define NICEHERO_HAS_STRTOD_L
 #endif
 
 #ifndef CHAR_BIT
 #define CHAR_BIT      8
 #endif // !CHAR_BIT
 
+#if defined(__SIZEOF_INT128__) && !defined(NICEHERO_NO_INT128)
+#define NICEHERO_HAS_INT128
+#endif
+
 
 namespace nicehero {
 
+#if defined(NICEHERO_HAS_INT128)
+	__extension__ typedef __int128 int128_t;
+	__extension__ typedef unsigned __int128 uint128_t;
+#endif
+
 	namespace type_traits {
 
 		// is_char8
@@ -71,11 +86,21 @@ namespace nicehero {
 		template <class T, class Enable = void>
 		struct is_int128_type : std::false_type {};
 
+#if defined(NICEHERO_HAS_INT128)
+		template <class T>
+		struct is_int128_type<T,typename std::enable_if<std::is_same<T,int128_t>::value>::type> : std::true_type {};
+#endif
+
 		// is_unsigned_integer
 
 		template <class T, class Enable = void>
 		struct is_uint128_type : std::false_type {};
 
+#if defined(NICEHERO_HAS_INT128)
+		template <class T>
+		struct is_uint128_type<T,typename std::enable_if<std::is_same<T,uint128_t>::value>::type> : std::true_type {};
+#endif
+
 		template <class T, class Enable = void>
 		class integer_limits
 		{
@@ -1484,6 +1509,229 @@ to_integer_unchecked(const CharT* s, std::size_t length, T& n)
     return to_integer_result<T,CharT>(s, to_integer_errc());
 }
 
+// c_locale
+
+// The C locale the _c conversions read numbers in. It is created on first use and shared
+// read-only by every thread; glibc hands out its built-in C locale without allocating
+
+#if defined(NICEHERO_HAS_MSC_STRTOD_L)
+inline _locale_t c_locale()
+{
+    static const _locale_t locale = _create_locale(LC_NUMERIC, "C");
+    return locale;
+}
+#elif defined(NICEHERO_HAS_STRTOLD_L) || defined(NICEHERO_HAS_STRTOD_L)
+inline locale_t c_locale()
+{
+    static const locale_t locale = newlocale(LC_ALL_MASK, "C", (locale_t) 0);
+    return locale;
+}
+#endif
+
+// Copies exactly length chars NUL-terminated into small, or into large when they do not fit,
+// without a _l variant '.' becomes the locale's decimal point
+
+inline char* c_number_text(const char* s, std::size_t length, char (&small)[64], std::string& large)
+{
+    char* p = small;
+    if (length < sizeof(small))
+    {
+        std::memcpy(small, s, length);
+        small[length] = 0;
+    }
+    else
+    {
+        large.assign(s, length);
+        p = &large[0];
+    }
+#if !defined(NICEHERO_HAS_MSC_STRTOD_L) && !defined(NICEHERO_HAS_STRTOLD_L) && !defined(NICEHERO_HAS_STRTOD_L) && !defined(NICEHERO_NO_LOCALECONV)
+    struct lconv * lc = localeconv();
+    if (lc != nullptr && lc->decimal_point[0] != 0 && lc->decimal_point[0] != '.')
+    {
+        char* dot = (char*)std::memchr(p, '.', length);
+        if (dot)
+        {
+            *dot = lc->decimal_point[0];
+        }
+    }
+#endif
+    return p;
+}
+
+// strtof_c
+
+// strtof over exactly length chars, read in the C locale
+
+inline bool strtof_c(const char* s, std::size_t length, float& result)
+{
+    char small[64];
+    std::string large;
+    char* p = c_number_text(s, length, small, large);
+    char* end = nullptr;
+#if defined(NICEHERO_HAS_MSC_STRTOD_L)
+    result = _strtof_l(p, &end, c_locale());
+#elif defined(NICEHERO_HAS_STRTOLD_L) || defined(NICEHERO_HAS_STRTOD_L)
+    result = strtof_l(p, &end, c_locale());
+#else
+    result = strtof(p, &end);
+#endif
+    return end != p;
+}
+
+// strtod_c
+
+// strtod over exactly length chars, read in the C locale, nothing is allocated for
+// numbers shorter than 64 chars so it is safe on allocation-free paths
+
+inline bool strtod_c(const char* s, std::size_t length, double& result)
+{
+    char small[64];
+    std::string large;
+    char* p = c_number_text(s, length, small, large);
+    char* end = nullptr;
+#if defined(NICEHERO_HAS_MSC_STRTOD_L)
+    result = _strtod_l(p, &end, c_locale());
+#elif defined(NICEHERO_HAS_STRTOLD_L)
+    result = double(strtold_l(p, &end, c_locale()));
+#elif defined(NICEHERO_HAS_STRTOD_L)
+    result = strtod_l(p, &end, c_locale());
+#else
+    result = strtod(p, &end);
+#endif
+    return end != p;
+}
+
+// to_float
+
+// Parses a json number to the nearest float. A significand of at most 19 digits
+// that fits in 53 bits, scaled by an exact power of ten, gives a correctly rounded
+// double; narrowing that to float is correct too unless it lies exactly on a float
+// rounding midpoint. Everything else goes through strtof_c.
+
+inline bool to_float(const char* s, std::size_t length, float& result)
+{
+    static constexpr double pow10[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+        1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+
+    const char* p = s;
+    const char* end = s + length;
+    bool is_negative = false;
+    if (p < end && *p == '-')
+    {
+        is_negative = true;
+        ++p;
+    }
+    uint64_t significand = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool is_exact = true;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p)
+    {
+        if (digits < 19)
+        {
+            significand = significand * 10 + uint64_t(*p - '0');
+            digits += significand != 0;
+        }
+        else
+        {
+            is_exact = false;
+        }
+    }
+    if (p < end && *p == '.')
+    {
+        ++p;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        {
+            if (digits < 19)
+            {
+                significand = significand * 10 + uint64_t(*p - '0');
+                digits += significand != 0;
+                --exponent;
+            }
+            else
+            {
+                is_exact = false;
+            }
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        bool exponent_is_negative = false;
+        if (p < end && (*p == '+' || *p == '-'))
+        {
+            exponent_is_negative = *p == '-';
+            ++p;
+        }
+        int e = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        {
+            if (e < 10000)
+            {
+                e = e * 10 + (*p - '0');
+            }
+        }
+        exponent += exponent_is_negative ? -e : e;
+    }
+    if (p == end && is_exact && significand <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double d = double(significand);
+        d = exponent < 0 ? d / pow10[-exponent] : d * pow10[exponent];
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        if (d == 0 || (d >= FLT_MIN && d <= FLT_MAX && (bits & 0x1FFFFFFF) != 0x10000000))
+        {
+            float f = float(d);
+            result = is_negative ? -f : f;
+            return true;
+        }
+    }
+    return strtof_c(s, length, result);
+}
+
+#if defined(NICEHERO_HAS_INT128)
+
+// Same precondition as to_integer_unchecked, digits are read 19 at a time
+// into a uint64_t so there is one 128-bit multiply per chunk instead of per digit
+
+template <class CharT>
+to_integer_result<int128_t,CharT> to_int128_unchecked(const CharT* s, std::size_t length, int128_t& n)
+{
+    static constexpr uint64_t pow10[] = {1ull,10ull,100ull,1000ull,10000ull,100000ull,1000000ull,10000000ull,
+        100000000ull,1000000000ull,10000000000ull,100000000000ull,1000000000000ull,10000000000000ull,
+        100000000000000ull,1000000000000000ull,10000000000000000ull,100000000000000000ull,
+        1000000000000000000ull,10000000000000000000ull};
+
+    n = 0;
+    const CharT* end = s + length;
+    bool is_negative = *s == '-';
+    if (is_negative)
+    {
+        ++s;
+    }
+    const uint128_t max_value = is_negative ? (uint128_t(1) << 127) : (uint128_t(1) << 127) - 1;
+    uint128_t u = 0;
+    while (s < end)
+    {
+        std::size_t k = (std::size_t)(end - s) < 19 ? (std::size_t)(end - s) : 19;
+        uint64_t chunk = 0;
+        for (std::size_t i = 0; i < k; ++i)
+        {
+            chunk = chunk * 10 + uint64_t(s[i] - '0');
+        }
+        if (u > (max_value - chunk) / pow10[k])
+        {
+            return to_integer_result<int128_t,CharT>(s, to_integer_errc::overflow);
+        }
+        u = u * pow10[k] + chunk;
+        s += k;
+    }
+    n = is_negative ? int128_t(0 - u) : int128_t(u);
+    return to_integer_result<int128_t,CharT>(s, to_integer_errc());
+}
+
+#endif
+
 // base16_to_integer
 
 template <class T, class CharT>
@@ -43,6 +43,7 @@ namespace nicehero {
 		string_short_value,
 		string_long_value,
 		boolean_value,
+		float_value,
 	};
 	enum class boolean_value_type : uint8_t
 	{
@@ -71,12 +72,14 @@ namespace nicehero {
 		viewvalue() {
 			m_start = nullptr;
 			m_len = 0;
+			m_escaped = 0;
 			get_type_ref() = value_type::string_view_value;
 		}
 
 		viewvalue(const char* s, uint32_t len = 0) {
 			m_start = s;
 			m_len = len;
+			m_escaped = 0;
 			get_type_ref() = value_type::string_view_value;
 		}
 		viewvalue(const copy_str_ref& cpystr) {
@@ -105,6 +108,10 @@ namespace nicehero {
 			m_double = v;
 			get_type_ref() = value_type::double_value;
 		}
+		viewvalue(float v) {
+			m_float = v;
+			get_type_ref() = value_type::float_value;
+		}
 		viewvalue(bool v) {
 			m_boolean = v;
 			get_type_ref() = value_type::boolean_value;
@@ -120,6 +127,14 @@ namespace nicehero {
 			m_double = v;
 			get_type_ref() = value_type::double_value;
 		}
+		void init(float v) {
+			if (get_type_ref() == value_type::string_long_value && m_strlong) {
+				delete[] m_strlong;
+				m_strlong = nullptr;
+			}
+			m_float = v;
+			get_type_ref() = value_type::float_value;
+		}
 		void init(uint64_t v) {
 			if (get_type_ref() == value_type::string_long_value && m_strlong) {
 				delete[] m_strlong;
@@ -128,6 +143,9 @@ namespace nicehero {
 			m_ui64 = v;
 			get_type_ref() = value_type::uint64_value;
 		}
+		void init(bool v) {
+			init(v ? boolean_value_type::boolean_value_true : boolean_value_type::boolean_value_false);
+		}
 		void init(boolean_value_type v) {
 			if (get_type_ref() == value_type::string_long_value && m_strlong) {
 				delete[] m_strlong;
@@ -206,6 +224,7 @@ namespace nicehero {
 					++len_;
 				}
 				m_strlong = new char[len_ + 1];
+				m_len = len_;
 				memcpy(m_strlong, cpystr.m_str, len_ + 1);
 				m_strlong[len_] = '\0';
 				return;
@@ -237,6 +256,7 @@ namespace nicehero {
 			}
 			m_start = start;
 			m_len = len;
+			m_escaped = 0;
 			get_type_ref() = value_type::string_view_value;
 		}
 		void init(const std::string& s) {
@@ -488,6 +508,9 @@ namespace nicehero {
 		}
 		std::string to_string() const;
 		std::string& parse2string(std::string& ss) const;
+		//appends the text of the value to anything with append(const char*, size_t) and push_back
+		template <class Result>
+		Result& write_to(Result& ss) const;
 
 		viewvalue& operator=(const viewvalue& rhs) {
 			auto t = rhs.get_type();
@@ -512,6 +535,42 @@ namespace nicehero {
 			return *this;
 		}
 
+		//a view of double-quoted JSON text, its escapes are already in place
+		bool is_escaped() const {
+			return get_type() == value_type::string_view_value && m_escaped != 0;
+		}
+		void set_escaped(bool escaped) {
+			if (get_type() == value_type::string_view_value) {
+				m_escaped = escaped ? 1 : 0;
+			}
+		}
+		//text of a string value, nullptr for the other types
+		const char* string_data(size_t& len) const {
+			switch (get_type())
+			{
+			case value_type::string_view_value:
+				if (!m_start) {
+					len = 0;
+					return "";
+				}
+				len = m_len > 0 ? m_len : strlen(m_start);
+				return m_start;
+			case value_type::string_short_value:
+				len = 0;
+				while (len < string_short_size && m_strshort[len] != '\0') {
+					++len;
+				}
+				return m_strshort;
+			case value_type::string_long_value:
+				len = m_len;
+				return m_strlong;
+			default:
+				break;
+			}
+			len = 0;
+			return nullptr;
+		}
+
 		bool is_string() const {
 			auto t = get_type();
 			if (t == value_type::string_long_value || t == value_type::string_short_value || t == value_type::string_view_value) {
@@ -525,6 +584,7 @@ namespace nicehero {
 			struct {
 				const char* m_start;
 				uint32_t m_len;
+				uint8_t m_escaped;
 			};
 			char m_strshort[string_short_size];
 			char* m_strlong;
@@ -533,6 +593,7 @@ namespace nicehero {
 			uint32_t m_ui32;
 			int32_t m_i32;
 			double m_double;
+			float m_float;
 			bool m_boolean;
 		};
 		//fields end
@@ -545,6 +606,12 @@ namespace nicehero {
 	}
 
 	inline std::string& viewvalue::parse2string(std::string& ss) const
+	{
+		return write_to(ss);
+	}
+
+	template <class Result>
+	inline Result& viewvalue::write_to(Result& ss) const
 	{
 		auto* cur = this;
 		auto t = cur->get_type();
@@ -572,45 +639,37 @@ namespace nicehero {
 // 			ss += std::to_string(cur->m_double);
 			break;
 		}
+		case value_type::float_value: {
+			ftoa_shortest(cur->m_float, ss);
+			break;
+		}
 		case value_type::boolean_value: {
 			if (cur->m_boolean) {
-				ss += "true";
+				ss.append("true", 4);
 			}
 			else {
-				ss += "false";
+				ss.append("false", 5);
 			}
 			break;
 		}
 		case value_type::string_short_value: {
-			if (cur->m_strshort[viewvalue::string_short_size - 1] == '0') {
-				ss += cur->m_strshort;
-			}
-			else {
-				for (size_t i = 0; i < sizeof(cur->m_strshort); ++i) {
-					if (cur->m_strshort[i] == '\0') {
-						break;
-					}
-					ss += cur->m_strshort[i];
-				}
+			size_t len = 0;
+			while (len < string_short_size && cur->m_strshort[len] != '\0') {
+				++len;
 			}
+			ss.append(cur->m_strshort, len);
 			break;
 		}
 		case value_type::string_long_value: {
-			ss += cur->m_strlong;
+			ss.append(cur->m_strlong, cur->m_len);
 			break;
 		}
 		case value_type::string_view_value: {
 			if (cur->m_len > 0 && cur->m_start) {
-#ifndef NICEHERO_HAS_2017
-				for (uint32_t i = 0; i < m_len; ++i) {
-					ss += cur->m_start[i];
-				}
-#else
-				ss += std::string_view(cur->m_start, cur->m_len);
-#endif
+				ss.append(cur->m_start, cur->m_len);
 			}
 			else if (cur->m_start) {
-				ss += cur->m_start;
+				ss.append(cur->m_start, strlen(cur->m_start));
 			}
 			break;
 		}
@@ -654,6 +713,11 @@ namespace nicehero {
 			f(v.m_double, ss);
 			cout_ << ss;
 		}
+		else if (t == value_type::float_value) {
+			std::string ss;
+			ftoa_shortest(v.m_float, ss);
+			cout_ << ss;
+		}
 		else if (t == value_type::boolean_value) {
 			if (v.m_boolean) {
 				cout_ << "true";
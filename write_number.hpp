@@ -15,6 +15,8 @@
 #include <limits> // std::numeric_limits
 #include <exception>
 #include <stdio.h> // snprintf
+#include <stdlib.h> // strtof
+#include <cstring>
 #include "parse_number.hpp"
 
 namespace nicehero { 
@@ -271,6 +273,75 @@ namespace nicehero {
 		return result;
 	}
 
+	// grisu3 for float, boundaries are half a float ulp instead of half a double ulp
+
+	constexpr int sp_significand_size = 23;
+	constexpr int sp_exponent_bias = (0x7F + sp_significand_size);
+	constexpr uint32_t sp_exponent_mask = 0x7F800000;
+	constexpr uint32_t sp_significand_mask = 0x007FFFFF;
+	constexpr uint32_t sp_hidden_bit = 0x00800000;
+
+	inline diy_fp_t float2diy_fp(float d)
+	{
+		uint32_t d32;
+		std::memcpy(&d32, &d, sizeof(d32));
+		int biased_e = (d32 & sp_exponent_mask) >> sp_significand_size;
+		uint32_t significand = (d32 & sp_significand_mask);
+		diy_fp_t res;
+		if (biased_e != 0)
+		{
+			res.f = significand + sp_hidden_bit;
+			res.e = biased_e - sp_exponent_bias;
+		}
+		else
+		{
+			res.f = significand;
+			res.e = -sp_exponent_bias + 1;
+		}
+		return res;
+	}
+
+	inline void normalized_boundaries_float(float d, diy_fp_t *out_m_minus, diy_fp_t *out_m_plus)
+	{
+		diy_fp_t v = float2diy_fp(d);
+		diy_fp_t pl, mi;
+		bool significand_is_zero = v.f == sp_hidden_bit;
+		pl.f = (v.f << 1) + 1; pl.e = v.e - 1;
+		pl = normalize_boundary(pl);
+		if (significand_is_zero)
+		{
+			mi.f = (v.f << 2) - 1;
+			mi.e = v.e - 2;
+		}
+		else
+		{
+			mi.f = (v.f << 1) - 1;
+			mi.e = v.e - 1;
+		}
+		int x = mi.e - pl.e;
+		mi.f <<= x;
+		mi.e = pl.e;
+		*out_m_plus = pl;
+		*out_m_minus = mi;
+	}
+
+	inline bool grisu3_float(float v, char *buffer, int *length, int *K)
+	{
+		diy_fp_t w_m, w_p;
+		int q = 64, alpha = -59, gamma = -56;
+		normalized_boundaries_float(v, &w_m, &w_p);
+		diy_fp_t w = normalize_diy_fp(float2diy_fp(v));
+		int mk = k_comp(w_p.e + q, alpha, gamma);
+		diy_fp_t c_mk = cached_power(mk);
+		diy_fp_t W = multiply(w, c_mk);
+		diy_fp_t Wp = multiply(w_p, c_mk);
+		diy_fp_t Wm = multiply(w_m, c_mk);
+		*K = -mk;
+		bool result = digit_gen(Wm, W, Wp, buffer, length, K);
+		buffer[*length] = 0;
+		return result;
+	}
+
     inline char to_hex_character(uint8_t c)
     {
         return (char)((c < 10) ? ('0' + c) : ('A' - 10 + c));
@@ -322,6 +393,64 @@ namespace nicehero {
         return count;
     }
 
+#if defined(NICEHERO_HAS_INT128)
+
+    // from_int128, writes 19 digit chunks so there is one 128-bit division per chunk
+
+    template<class Result>
+    std::size_t from_int128(int128_t value, Result& result)
+    {
+        static constexpr uint64_t chunk_div = 10000000000000000000ull;
+        using char_type = typename Result::value_type;
+
+        uint128_t u = value < 0 ? uint128_t(0) - uint128_t(value) : uint128_t(value);
+        uint64_t chunks[3];
+        int chunk_count = 0;
+        while (u >= chunk_div)
+        {
+            chunks[chunk_count++] = uint64_t(u % chunk_div);
+            u /= chunk_div;
+        }
+
+        char_type buf[40];
+        char_type *p = buf;
+        uint64_t head = uint64_t(u);
+        do
+        {
+            *p++ = static_cast<char_type>(48 + head % 10);
+        }
+        while (head /= 10);
+
+        std::size_t count = (p - buf);
+        if (value < 0)
+        {
+            result.push_back('-');
+            ++count;
+        }
+        while (--p >= buf)
+        {
+            result.push_back(*p);
+        }
+        while (chunk_count > 0)
+        {
+            uint64_t c = chunks[--chunk_count];
+            char_type digits[19];
+            for (int i = 18; i >= 0; --i)
+            {
+                digits[i] = static_cast<char_type>(48 + c % 10);
+                c /= 10;
+            }
+            for (int i = 0; i < 19; ++i)
+            {
+                result.push_back(digits[i]);
+            }
+            count += 19;
+        }
+        return count;
+    }
+
+#endif
+
     // integer_to_string_hex
 
     template<class Integer,class Result>
@@ -705,12 +834,188 @@ namespace nicehero {
     {
         return dtoa_general(v, decimal_point, result, std::integral_constant<bool, std::numeric_limits<double>::is_iec559>());
     }
+    // ftoa_shortest, the shortest digits that read back as the same float
+
+    template<class Result>
+    bool ftoa_shortest(float v, Result& result)
+    {
+        if (v == 0)
+        {
+            if (std::signbit(v))
+            {
+                result.push_back('-');
+            }
+            result.push_back('0');
+            result.push_back('.');
+            result.push_back('0');
+            return true;
+        }
+        if (!std::isfinite(v))
+        {
+            return dtoa_general(double(v), '.', result);
+        }
+
+        int length = 0;
+        int k;
+
+        char buffer[100];
+
+        float u = std::signbit(v) ? -v : v;
+        if (!nicehero::grisu3_float(u, buffer, &length, &k))
+        {
+            for (int precision = 1; precision <= std::numeric_limits<float>::max_digits10; ++precision)
+            {
+                // only the digits and the exponent are taken, whatever the locale's decimal point
+                char sbuffer[100];
+                snprintf(sbuffer, sizeof(sbuffer), "%.*e", precision - 1, double(u));
+                length = 0;
+                for (const char* q = sbuffer; *q != 'e'; ++q)
+                {
+                    if (*q >= '0' && *q <= '9')
+                    {
+                        buffer[length++] = *q;
+                    }
+                }
+                k = atoi(strchr(sbuffer, 'e') + 1) - (length - 1);
+                char cbuffer[100];
+                int clength = snprintf(cbuffer, sizeof(cbuffer), "%.*se%d", length, buffer, k);
+                float back;
+                if (clength > 0 && nicehero::to_float(cbuffer, std::size_t(clength), back) && back == u)
+                {
+                    break;
+                }
+            }
+        }
+        if (std::signbit(v))
+        {
+            result.push_back('-');
+        }
+        nicehero::prettify_string(buffer, length, k, -4, std::numeric_limits<double>::max_digits10, result);
+        return true;
+    }
+
+    // Writes v with exactly precision decimals, rounded like printf("%.*f").
+    // Magnitudes below 2^53 with 1..9 decimals use integer arithmetic only:
+    // v = m * 2^-k, so the decimals are floor(frac * 5^p / 2^(k-p)) with the
+    // remainder deciding round-half-even.
+    template<class Result>
+    void dtoa_fixed_precision(double v, int precision, Result& result)
+    {
+        static const uint32_t pow5[] = {1,5,25,125,625,3125,15625,78125,390625,1953125};
+        static const uint32_t pow10[] = {1,10,100,1000,10000,100000,1000000,10000000,100000000,1000000000};
+        uint64_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        const int biased = int((bits >> 52) & 0x7FF);
+        if (biased == 0x7FF)
+        {
+            dtoa_general(v, '.', result);
+            return;
+        }
+        if (precision < 1 || precision > 9 || biased >= 1023 + 53)
+        {
+            char buffer[400];
+            int length = snprintf(buffer, sizeof(buffer), "%1.*f", precision, v);
+            if (length > 0)
+            {
+                dump_buffer(buffer, size_t(length) < sizeof(buffer) ? length : sizeof(buffer) - 1, '.', result);
+            }
+            return;
+        }
+        uint64_t m = bits & ((uint64_t(1) << 52) - 1);
+        int k = 1074;
+        if (biased != 0)
+        {
+            m |= uint64_t(1) << 52;
+            k = 1075 - biased;
+        }
+        uint64_t ip = 0;
+        uint64_t frac = m;
+        if (k <= 0)
+        {
+            ip = m << -k;
+            frac = 0;
+        }
+        else if (k < 64)
+        {
+            ip = m >> k;
+            frac = m & ((uint64_t(1) << k) - 1);
+        }
+        // n = frac * 5^p as 128 bits, value of the decimals is n / 2^t
+        const uint64_t q = pow5[precision];
+        const uint64_t lo_part = (frac & 0xFFFFFFFF) * q;
+        const uint64_t hi_part = (frac >> 32) * q;
+        uint64_t lo = lo_part + (hi_part << 32);
+        uint64_t hi = (hi_part >> 32) + (lo < lo_part ? 1 : 0);
+        const int t = k - precision;
+        uint64_t d = 0;
+        bool round_up = false;
+        if (frac == 0)
+        {
+        }
+        else if (t <= 0)
+        {
+            d = lo << -t;
+        }
+        else if (t < 128)
+        {
+            uint64_t rem_hi, rem_lo, half_hi, half_lo;
+            if (t < 64)
+            {
+                d = (lo >> t) | (hi << 1 << (63 - t));
+                rem_hi = 0;
+                rem_lo = lo & ((uint64_t(1) << t) - 1);
+                half_hi = 0;
+                half_lo = uint64_t(1) << (t - 1);
+            }
+            else
+            {
+                d = t == 64 ? hi : hi >> (t - 64);
+                rem_hi = t == 64 ? 0 : hi & ((uint64_t(1) << (t - 64)) - 1);
+                rem_lo = lo;
+                half_hi = t == 64 ? 0 : uint64_t(1) << (t - 65);
+                half_lo = t == 64 ? uint64_t(1) << 63 : 0;
+            }
+            if (rem_hi != half_hi)
+            {
+                round_up = rem_hi > half_hi;
+            }
+            else if (rem_lo != half_lo)
+            {
+                round_up = rem_lo > half_lo;
+            }
+            else
+            {
+                round_up = (d & 1) != 0;
+            }
+        }
+        if (round_up && ++d == pow10[precision])
+        {
+            d = 0;
+            ++ip;
+        }
+        if (bits >> 63)
+        {
+            result.push_back('-');
+        }
+        from_integer(ip, result);
+        result.push_back('.');
+        char buffer[9];
+        for (int i = precision - 1; i >= 0; --i)
+        {
+            buffer[i] = char('0' + d % 10);
+            d /= 10;
+        }
+        for (int i = 0; i < precision; ++i)
+        {
+            result.push_back(buffer[i]);
+        }
+    }
+
 	enum class float_chars_format : uint8_t { general, fixed, scientific, hex };
 
     class write_double
     {
     private:
-        to_double_t to_double_;
         float_chars_format float_format_;
         int precision_;
         char decimal_point_;
@@ -744,11 +1049,7 @@ namespace nicehero {
                 {
                     if (precision_ > 0)
                     {
-                        length = snprintf(number_buffer, sizeof(number_buffer), "%1.*f", precision_, val);
-                        if (length < 0)
-                        {
-                        }
-                        dump_buffer(number_buffer, length, decimal_point_, result);
+                        dtoa_fixed_precision(val, precision_, result);
                     }
                     else
                     {